@@ -1,43 +1,57 @@
-#ifndef DATACENTERS_WET1_AVL_H
-#define DATACENTERS_WET1_AVL_H
+#ifndef DATACENTERS_WET2_AVL_H
+#define DATACENTERS_WET2_AVL_H
 
+#include <new>
 #include "Server.h"
+#include "Parallel.h"
+
+const int NULL_NODE = -1;           // no node
+const int MIN_POOL_SIZE = 4;        // the node pool grows by half of its size, starting here
+const int AVL_MAX_SIZE = (1 << 26) - 1; // subTreeSize has 26 bits
+const int AVL_MAX_HEIGHT = 63;          // height has 6 bits
 
 enum AVLResult { AVL_SUCCESS, AVL_FAILURE, AVL_INVALID_INPUT, AVL_ALREADY_EXIST, AVL_NOT_EXIST };
 
-class TreeNode {
+// The nodes keep the key once, and the links are indices in the tree's node pool.
+// Besides the height and the subtree size, a node keeps only the aggregate its tree's policy asks for
+template<class Key, class Aggregate>
+class AVLNode {
 public:
-    ServerKey key;
-    Server data;
-    TreeNode* parent, * left, * right;
-    int height;
-    int subTreeSize, subTreeTraffic;
-
-    TreeNode(ServerKey key,
-             Server data,
-             TreeNode* parent = nullptr) :
-            key(key), data(data),
-            parent(parent), left(nullptr), right(nullptr),
-            height(0), subTreeSize(1), subTreeTraffic(data.traffic)  {};
-    // Initial Subtree size of a leaf = 1
-    // Initial Subtree traffic = given server's traffic
+    Key key;
+    int parent, left, right;
+    unsigned int subTreeSize : 26;
+    unsigned int height : 6;
+    Aggregate aggregate;
 
-    int getBalanceFactor() const;
-    bool isLeftSubtree() const;
-    bool isLeaf() const;
-    bool hasSingleSon() const;
-    bool hasTwoSons() const;
-    void updateRanks();
+    AVLNode() = default;
+    AVLNode(const Key& key, int parent, const Aggregate& aggregate) :
+            key(key),
+            parent(parent), left(NULL_NODE), right(NULL_NODE),
+            subTreeSize(1), height(0), aggregate(aggregate)  {};
+    // Initial Subtree size of a leaf = 1
+    // Initial Subtree aggregate = the given key's
 
-    static void swap(TreeNode& A, TreeNode& B);
+    bool isLeaf() const { return (left == NULL_NODE && right == NULL_NODE); }
+    bool hasTwoSons() const { return (left != NULL_NODE && right != NULL_NODE); }
+    bool hasSingleSon() const { return (!isLeaf() && !hasTwoSons()); }
 };
 
-class AVL {
+// An AVL rank tree over keys (they need < and !=), augmented at compile time by a policy:
+//     typedef ... Aggregate;                                  what a node keeps about its subtree
+//     static Aggregate Identity();                            of an empty subtree
+//     static Aggregate Of(const Key& key);                    of a single key (its value is read from it)
+//     static Aggregate Combine(const Aggregate& lower, const Aggregate& higher);  associative
+// See AggregatePolicies.h.
+template<class Key, class Policy>
+class AugmentedAVL {
 public:
+    typedef typename Policy::Aggregate Aggregate;
+    typedef AVLNode<Key, Aggregate> Node;
+
     class TreeIterator {
     public:
-        TreeIterator() : curr(nullptr), last(nullptr) {};
-        Server& operator*() const;
+        TreeIterator() : tree(nullptr), curr(NULL_NODE), last(NULL_NODE) {};
+        const Key& operator*() const;
         bool isEnd() const;
         const TreeIterator operator++(int);
         const TreeIterator operator--(int);
@@ -45,44 +59,1007 @@ public:
         bool operator==(const TreeIterator& other) const;
         bool operator!=(const TreeIterator& other) const;
 
-        friend AVL;
-        TreeNode *curr, * last;
+        friend AugmentedAVL;
+        const AugmentedAVL* tree;
+        int curr, last;
     };
 
-    AVL();
-    AVL(const AVL& other);
-    AVL& operator=(const AVL& other);
+    AugmentedAVL();
+    AugmentedAVL(const AugmentedAVL& other);
+    AugmentedAVL(AugmentedAVL&& other) noexcept;
+    AugmentedAVL& operator=(const AugmentedAVL& other);
+    AugmentedAVL& operator=(AugmentedAVL&& other) noexcept;
+
+    ~AugmentedAVL();
+    TreeIterator find(const Key& key) const;
+    AVLResult insert(const Key& key, int* handle = nullptr);
+    AVLResult remove(const Key& key);
 
-    ~AVL();
-    TreeIterator find(const ServerKey& key) const;
-    AVLResult insert(const ServerKey& key, const Server& data);
-    AVLResult remove(const ServerKey& key);
+    // a handle is the index of a key's node. it stays valid until the key is removed,
+    // through rotations and removals of other keys, and in copies of the tree (but not in merges)
+    AVLResult removeAt(int handle);
+    AVLResult update(int handle, const Key& key, int* newHandle);    // change the key of a node
     TreeIterator begin() const;
     TreeIterator end() const;
     TreeIterator Rbegin() const;
 
-    static AVL MergeRankTrees(const AVL& a, const AVL& b);
-    int SumHighestTrafficServers(int k);
+    static AugmentedAVL MergeRankTrees(const AugmentedAVL& a, const AugmentedAVL& b);
+    static AugmentedAVL BuildFromSorted(const Key* sorted, int count);
+    Aggregate HighestAggregate(int k) const;     // of the k highest keys
+    // HighestAggregate of every k in ks (ascending), in one descent: each subtree is entered once for all its ks
+    void HighestAggregates(const int* ks, int count, Aggregate* aggregates) const;
+    Aggregate AggregateAtLeast(const Key& bound, int* count) const;   // of the keys that aren't smaller than bound
+    const Key& SelectHighest(int k) const;      // the k-th highest key, 1 <= k <= size
+
+    // calls function(key) on the keys that aren't bigger than upper (on all of them if upper is nullptr),
+    // in descending order, while it returns true. the path is kept on a stack, no parent links are followed
+    template<class Function>
+    void ForEachDown(const Key* upper, Function function) const;
+    int Size() const { return size; }
 
 private:
-    // the actual tree is the dummy's left subtree
-    TreeNode* dummyRoot;
+    // all the nodes live in one pool, removed nodes are linked by their right indices
+    Node* nodes;
+    int capacity, used;
+    int freeNodes;
+    int root;
     int size;
 
-    void fixTree(TreeNode* root);
-    void BalanceSubTree(TreeNode* root);
-    void rotateRight(TreeNode* root);
-    void rotateLeft(TreeNode* root);
+    void fixTree(int node);
+    void BalanceSubTree(int node);
+    void rotateRight(int node);
+    void rotateLeft(int node);
+    void replaceSon(int parent, int son, int newSon);
+    int getBalanceFactor(int node) const;
+    void updateRanks(int node);
+    void HighestAggregatesHelp(int node, const int* ks, int count, int taken, Aggregate higher, Aggregate* aggregates) const;
+    static void SetRanks(Node* nodes, int node);    // from the sons' ranks
 
-    void CopyTree(const AVL& other); // ONLY called from the copy ctor and assignment operator
+    void CopyTree(const AugmentedAVL& other); // ONLY called from the copy ctor and assignment operator
+    void TakeOver(AugmentedAVL& other);     // takes other's pool, other is left empty
     void DestroyTree();
 
-    void InitializeAsEmptyTree(int init_size);
-    static TreeNode* MakeEmptyTreeHelp(int height);
-    void InitRanks();
-    static void InitRanksHelp(TreeNode* curr);
+    int AllocateNode(const Key& key, int parent);
+    void FreeNode(int node);
+    void AllocatePool(int poolCapacity);
+    template<class Source>
+    static int BuildTree(Source& source, Node* nodes, int first, int last, int parent);
+    template<class Source>
+    static int BuildTreeParallel(Source& source, Node* nodes, int first, int last, int parent, int depth);
+    static void ParallelMerge(const Key* a, int aSize, const Key* b, int bSize, Key* merged);
+    static int CoRank(int i, const Key* a, int aSize, const Key* b, int bSize);
+    static AugmentedAVL ParallelMergeRankTrees(const AugmentedAVL& a, const AugmentedAVL& b);
     static int log(int n);
-    static int pow(int base, int power);
 };
 
-#endif //DATACENTERS_WET1_AVL_H
+//-------------------------AVL TREE ITERATOR FUNCTIONS-------------------------
+
+template<class Key, class Policy>
+const Key& AugmentedAVL<Key, Policy>::TreeIterator::operator*() const {
+    // assert(curr != NULL_NODE); // can't dereference the end
+    return tree->nodes[curr].key;
+}
+
+template<class Key, class Policy>
+bool AugmentedAVL<Key, Policy>::TreeIterator::isEnd() const {
+    // check if reached end (went up from the root)
+    return curr == NULL_NODE;
+}
+
+template<class Key, class Policy>
+const typename AugmentedAVL<Key, Policy>::TreeIterator AugmentedAVL<Key, Policy>::TreeIterator::operator++(int) {
+    // check if reached end before ++
+    if (isEnd())
+        return *this;
+
+    Node* nodes = tree->nodes;
+    // doSomething(curr) was done
+
+    // if a right subtree exists
+    if (nodes[curr].right != NULL_NODE) {
+        last = curr;
+        curr = nodes[curr].right; // go right
+
+        // and then go left as much as possible
+        while (nodes[curr].left != NULL_NODE) {
+            last = curr;
+            curr = nodes[curr].left;
+        }
+    }
+    else {
+        // no right subtree exists
+        last = curr;
+        curr = nodes[curr].parent; // go up
+
+        // if you came back from a right subtree
+        // keep rising until you come back from a left subtree
+        while (!isEnd() && last == nodes[curr].right) {
+            last = curr;
+            curr = nodes[curr].parent;
+        }
+    }
+
+    return *this;   // doSomething(curr) will be done
+}
+
+
+
+template<class Key, class Policy>
+const typename AugmentedAVL<Key, Policy>::TreeIterator AugmentedAVL<Key, Policy>::TreeIterator::operator--(int) {
+    // check if reached end before --
+    if (isEnd())
+        return *this;
+
+    Node* nodes = tree->nodes;
+    // doSomething(curr) was done
+
+    // if a left subtree exists
+    if (nodes[curr].left != NULL_NODE) {
+        last = curr;
+        curr = nodes[curr].left; // go left
+
+        // and then go right as much as possible
+        while (nodes[curr].right != NULL_NODE) {
+            last = curr;
+            curr = nodes[curr].right;
+        }
+    }
+    else {
+        // no left subtree exists
+        last = curr;
+        curr = nodes[curr].parent; // go up
+
+        // if you came back from a left subtree
+        // keep rising until you come back from a right subtree
+        while (!isEnd() && last == nodes[curr].left) {
+            last = curr;
+            curr = nodes[curr].parent;
+        }
+    }
+
+    return *this;   // doSomething(curr) will be done
+}
+
+template<class Key, class Policy>
+bool AugmentedAVL<Key, Policy>::TreeIterator::operator<(const TreeIterator& other) const {
+    if (isEnd())
+        return false; // if this is the end, it's bigger
+
+    if (other.isEnd())
+        return true; // other is the end so it's bigger
+
+    // compare keys with key's operator <
+    return (**this < *other);
+}
+
+
+template<class Key, class Policy>
+bool AugmentedAVL<Key, Policy>::TreeIterator::operator==(const TreeIterator& other) const {
+    return (curr == other.curr);
+}
+
+template<class Key, class Policy>
+bool AugmentedAVL<Key, Policy>::TreeIterator::operator!=(const TreeIterator& other) const {
+    return !operator==(other);
+}
+//-------------------- SERVER RANK TREE FUNCTIONS --------------------
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy>::AugmentedAVL() : nodes(nullptr), capacity(0), used(0), freeNodes(NULL_NODE), root(NULL_NODE), size(0) {}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy>::AugmentedAVL(const AugmentedAVL& other) : nodes(nullptr), capacity(0), used(0), freeNodes(NULL_NODE), root(NULL_NODE), size(0) {
+    CopyTree(other);
+}
+
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy>::AugmentedAVL(AugmentedAVL&& other) noexcept : nodes(nullptr), capacity(0), used(0), freeNodes(NULL_NODE), root(NULL_NODE), size(0) {
+    TakeOver(other);
+}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy>& AugmentedAVL<Key, Policy>::operator=(AugmentedAVL&& other) noexcept {
+    if (this == &other) return *this;
+    DestroyTree();
+    TakeOver(other);
+    return *this;
+}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy>& AugmentedAVL<Key, Policy>::operator=(const AugmentedAVL& other) {
+    if (this == &other) return *this;
+
+    DestroyTree();
+    capacity = used = size = 0;
+    freeNodes = root = NULL_NODE;
+    CopyTree(other);
+    return *this;
+}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy>::~AugmentedAVL() {
+    DestroyTree();
+}
+
+template<class Key, class Policy>
+typename AugmentedAVL<Key, Policy>::TreeIterator AugmentedAVL<Key, Policy>::find(const Key& key) const {
+    int ptr = root;
+
+    while (ptr != NULL_NODE && key != nodes[ptr].key) {
+        if (key < nodes[ptr].key) {
+            ptr = nodes[ptr].left;
+        }
+        else {
+            ptr = nodes[ptr].right;
+        }
+    }
+
+    auto iter = end(); // if it doesn't exist - return end()
+
+    if (ptr != NULL_NODE) {
+        iter.last = nodes[ptr].parent;
+        iter.curr = ptr;
+    }
+    return iter;
+}
+
+
+template<class Key, class Policy>
+AVLResult AugmentedAVL<Key, Policy>::insert(const Key& key, int* handle) {
+    int ptr = root;
+    if (size != 0) {
+        int last = NULL_NODE;
+
+        // find where the new node should be placed
+        while (ptr != NULL_NODE && key != nodes[ptr].key) {
+            last = ptr;
+            if (key < nodes[ptr].key) {
+                ptr = nodes[ptr].left;
+            } else {
+                ptr = nodes[ptr].right;
+            }
+        }
+
+        if (ptr != NULL_NODE)
+            return AVL_ALREADY_EXIST;    // key is already in the tree
+        if (size == AVL_MAX_SIZE)
+            return AVL_FAILURE;
+
+        // Add the new node (the pool may move, so no references are kept over this)
+        ptr = AllocateNode(key, last);
+        if (key < nodes[last].key) {
+            nodes[last].left = ptr;
+        } else {
+            nodes[last].right = ptr;
+        }
+
+        // fix the tree
+        fixTree(last);
+    }
+    else
+    {
+        // tree is empty
+        root = ptr = AllocateNode(key, NULL_NODE);
+    }
+
+    size++;
+    if (handle) *handle = ptr;
+    return AVL_SUCCESS;
+}
+
+
+template<class Key, class Policy>
+AVLResult AugmentedAVL<Key, Policy>::remove(const Key& key) {
+    if (size == 0)
+        return AVL_SUCCESS;
+
+    // look for the node
+    TreeIterator iter = find(key);
+    if (iter == end())
+        return AVL_NOT_EXIST; // the key doesn't exist in the tree
+
+    return removeAt(iter.curr);
+}
+
+template<class Key, class Policy>
+AVLResult AugmentedAVL<Key, Policy>::removeAt(int handle) {
+    int to_delete = handle;
+    int to_fix;
+
+    if (nodes[to_delete].hasTwoSons()) {
+        // get next node in the inorder traversal (it has no left son)
+        int next = nodes[to_delete].right;
+        while (nodes[next].left != NULL_NODE) {
+            next = nodes[next].left;
+        }
+
+        // move the next node (not just its key) to the removed node's place,
+        // so the handle of the next node's key stays valid
+        if (next == nodes[to_delete].right) {
+            to_fix = next;
+        }
+        else {
+            to_fix = nodes[next].parent;
+            int next_right = nodes[next].right;
+            nodes[to_fix].left = next_right;
+            if (next_right != NULL_NODE)
+                nodes[next_right].parent = to_fix;
+
+            nodes[next].right = nodes[to_delete].right;
+            nodes[nodes[next].right].parent = next;
+        }
+        nodes[next].left = nodes[to_delete].left;
+        nodes[nodes[next].left].parent = next;
+        nodes[next].parent = nodes[to_delete].parent;
+        replaceSon(nodes[to_delete].parent, to_delete, next);
+    }
+    else {
+        int son = NULL_NODE;
+        if (nodes[to_delete].hasSingleSon()) {
+            // find which is the single son
+            son = nodes[to_delete].left;
+            if (son == NULL_NODE) {
+                son = nodes[to_delete].right;
+            }
+
+            // set the son's parent to be the removed node's parent
+            nodes[son].parent = nodes[to_delete].parent;
+        }
+
+        // set parent's son (if it's leaf son = NULL_NODE)
+        replaceSon(nodes[to_delete].parent, to_delete, son);
+        to_fix = nodes[to_delete].parent;
+    }
+
+    FreeNode(to_delete);
+    fixTree(to_fix);
+
+    size--; // update tree size
+
+    return AVL_SUCCESS;
+}
+
+template<class Key, class Policy>
+AVLResult AugmentedAVL<Key, Policy>::update(int handle, const Key& key, int* newHandle) {
+    // if the new key keeps its place between the neighbours, only the aggregates above change.
+    // it can only pass the neighbour in the direction it moves
+    TreeIterator neighbour = end();
+    neighbour.curr = handle;
+    bool inPlace;
+    if (nodes[handle].key < key) {
+        neighbour++;
+        inPlace = neighbour.isEnd() || key < *neighbour;
+    } else {
+        neighbour--;
+        inPlace = neighbour.isEnd() || *neighbour < key;
+    }
+
+    if (inPlace) {
+        nodes[handle].key = key;
+        for (int node = handle; node != NULL_NODE; node = nodes[node].parent) {
+            SetRanks(nodes, node);
+        }
+        *newHandle = handle;
+        return AVL_SUCCESS;
+    }
+
+    removeAt(handle);
+    return insert(key, newHandle);  // takes the freed node, there is room
+}
+
+template<class Key, class Policy>
+typename AugmentedAVL<Key, Policy>::TreeIterator AugmentedAVL<Key, Policy>::begin() const {
+    TreeIterator iter = end();
+    if (root == NULL_NODE) return iter;
+    iter.curr = root;
+
+    // go all the way left
+    while (nodes[iter.curr].left != NULL_NODE) {
+        iter.curr = nodes[iter.curr].left;
+    }
+    iter.last = nodes[iter.curr].parent;
+
+    return iter;
+}
+
+
+template<class Key, class Policy>
+typename AugmentedAVL<Key, Policy>::TreeIterator AugmentedAVL<Key, Policy>::Rbegin() const {
+    TreeIterator iter = end();
+    if (root == NULL_NODE) return iter;
+    iter.curr = root;
+
+    // go all the way right
+    while (nodes[iter.curr].right != NULL_NODE) {
+        iter.curr = nodes[iter.curr].right;
+    }
+    iter.last = nodes[iter.curr].parent;
+
+    return iter;
+}
+
+
+template<class Key, class Policy>
+typename AugmentedAVL<Key, Policy>::TreeIterator AugmentedAVL<Key, Policy>::end() const {
+    // above the root
+    TreeIterator iter;
+    iter.tree = this;
+    return iter;
+}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy> AugmentedAVL<Key, Policy>::MergeRankTrees(const AugmentedAVL& a, const AugmentedAVL& b) {
+    int newTreeSize = a.size + b.size;
+    if (newTreeSize > AVL_MAX_SIZE || newTreeSize < 0) throw std::bad_alloc();    // no room in subTreeSize
+
+    // very big merges are done in parallel
+    if (a.size > PARALLEL_MERGE_THRESHOLD && b.size > PARALLEL_MERGE_THRESHOLD) return ParallelMergeRankTrees(a, b);
+
+    AugmentedAVL newTree;
+    if (newTreeSize == 0) return newTree;
+
+    // do inorder on both trees together, and build the new tree in the same order
+    auto aIter = a.begin(), bIter = b.begin();
+    auto next = [&](int) -> const Key& {
+        if (bIter == b.end() || (aIter != a.end() && aIter < bIter)) {
+            const Key& key = *aIter;
+            aIter++;
+            return key;
+        }
+        const Key& key = *bIter;
+        bIter++;
+        return key;
+    };
+
+    newTree.AllocatePool(newTreeSize);
+    newTree.root = BuildTree(next, newTree.nodes, 0, newTreeSize - 1, NULL_NODE);
+    newTree.size = newTreeSize;
+
+    return newTree;
+}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy> AugmentedAVL<Key, Policy>::BuildFromSorted(const Key* sorted, int count) {
+    if (count > AVL_MAX_SIZE) throw std::bad_alloc();   // no room in subTreeSize
+
+    AugmentedAVL newTree;
+    if (count == 0) return newTree;
+
+    auto next = [&](int i) -> const Key& { return sorted[i]; };
+    newTree.AllocatePool(count);
+    newTree.root = BuildTree(next, newTree.nodes, 0, count - 1, NULL_NODE);
+    newTree.size = count;
+    return newTree;
+}
+
+template<class Key, class Policy>
+typename Policy::Aggregate AugmentedAVL<Key, Policy>::HighestAggregate(int k) const {
+    if (size == 0) return Policy::Identity(); // empty tree
+
+    // if tree size <= k return all tree's aggregate
+    if (size <= k) return nodes[root].aggregate;
+
+    // the k highest keys, combined from the highest down
+    Aggregate aggregate = Policy::Identity();
+    int curr = root;
+
+    while (k > 0) {
+        int right_node = nodes[curr].right;
+        if (right_node == NULL_NODE) { // right subtree size = 0
+            // no right subtree
+            // add this node's key and continue left
+            aggregate = Policy::Combine(Policy::Of(nodes[curr].key), aggregate);
+            k -= 1;
+            curr = nodes[curr].left;
+        }
+        else if ((int)nodes[right_node].subTreeSize >= k) {
+            // curr and curr's left subtree are not taken, go right
+            curr = right_node;
+        } else {
+            // add curr and curr's right subtree
+            // decrement k by curr's right subtree size + 1
+            // go left
+            aggregate = Policy::Combine(Policy::Of(nodes[curr].key), Policy::Combine(nodes[right_node].aggregate, aggregate));
+            k -= (nodes[right_node].subTreeSize + 1);
+            curr = nodes[curr].left;
+        }
+    }
+
+    return aggregate;
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::HighestAggregates(const int* ks, int count, Aggregate* aggregates) const {
+    HighestAggregatesHelp(root, ks, count, 0, Policy::Identity(), aggregates);
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::HighestAggregatesHelp(int node, const int* ks, int count, int taken,
+                                                      Aggregate higher, Aggregate* aggregates) const {
+    // the keys above node's subtree are taken already, higher is their aggregate. every k here is at least taken
+    while (count > 0) {
+        if (node == NULL_NODE) {
+            // nothing more to take (k = 0, or bigger than the tree)
+            for (int i = 0; i < count; i++) aggregates[i] = higher;
+            return;
+        }
+
+        // the ks that end inside the right subtree share the descent into it
+        int right_node = nodes[node].right;
+        int rightSize = right_node == NULL_NODE ? 0 : (int)nodes[right_node].subTreeSize;
+        int inRight = 0;
+        while (inRight < count && ks[inRight] <= taken + rightSize) inRight++;
+        if (inRight > 0) HighestAggregatesHelp(right_node, ks, inRight, taken, higher, aggregates);
+        ks += inRight;
+        aggregates += inRight;
+        count -= inRight;
+        if (count == 0) return;
+
+        // the rest take the right subtree and node, and go on left
+        if (right_node != NULL_NODE) higher = Policy::Combine(nodes[right_node].aggregate, higher);
+        higher = Policy::Combine(Policy::Of(nodes[node].key), higher);
+        taken += rightSize + 1;
+        while (count > 0 && ks[0] == taken) {
+            *aggregates++ = higher;
+            ks++;
+            count--;
+        }
+        node = nodes[node].left;
+    }
+}
+
+template<class Key, class Policy>
+typename Policy::Aggregate AugmentedAVL<Key, Policy>::AggregateAtLeast(const Key& bound, int* count) const {
+    Aggregate aggregate = Policy::Identity();
+    *count = 0;
+
+    // every node that is taken comes with its right subtree
+    int curr = root;
+    while (curr != NULL_NODE) {
+        if (nodes[curr].key < bound) {
+            curr = nodes[curr].right;
+            continue;
+        }
+        int right_node = nodes[curr].right;
+        Aggregate taken = Policy::Of(nodes[curr].key);
+        *count += 1;
+        if (right_node != NULL_NODE) {
+            *count += nodes[right_node].subTreeSize;
+            taken = Policy::Combine(taken, nodes[right_node].aggregate);
+        }
+        aggregate = Policy::Combine(taken, aggregate);
+        curr = nodes[curr].left;
+    }
+    return aggregate;
+}
+
+template<class Key, class Policy>
+const Key& AugmentedAVL<Key, Policy>::SelectHighest(int k) const {
+    int curr = root;
+    while (true) {
+        int right_node = nodes[curr].right;
+        int right_size = (right_node == NULL_NODE) ? 0 : (int)nodes[right_node].subTreeSize;
+        if (k <= right_size) {
+            curr = right_node;
+        } else if (k == right_size + 1) {
+            return nodes[curr].key;
+        } else {
+            // skip curr and curr's right subtree
+            k -= right_size + 1;
+            curr = nodes[curr].left;
+        }
+    }
+}
+
+template<class Key, class Policy>
+template<class Function>
+void AugmentedAVL<Key, Policy>::ForEachDown(const Key* upper, Function function) const {
+    int stack[AVL_MAX_HEIGHT + 1];
+    int depth = 0;
+
+    // the nodes on the way to the highest key in range, the top of the stack is the next one
+    for (int curr = root; curr != NULL_NODE; ) {
+        if (upper && *upper < nodes[curr].key) {
+            curr = nodes[curr].left;
+        } else {
+            stack[depth++] = curr;
+            curr = nodes[curr].right;
+        }
+    }
+
+    while (depth > 0) {
+        int curr = stack[--depth];
+        if (!function(nodes[curr].key)) return;
+
+        // the next key down is the highest of the left subtree, or the next node on the stack
+        for (int son = nodes[curr].left; son != NULL_NODE; son = nodes[son].right) stack[depth++] = son;
+    }
+}
+//-------------------------PRIVATE AVL FUNCTIONS-------------------------
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::fixTree(int node) {
+    while (node != NULL_NODE) {
+        updateRanks(node);
+        BalanceSubTree(node);
+        node = nodes[node].parent;
+    }
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::BalanceSubTree(int node) {
+    if (node == NULL_NODE)
+        return;
+
+    int BF = getBalanceFactor(node);
+    if (BF == 2) {
+        int BF_left = getBalanceFactor(nodes[node].left);
+        if (BF_left >= 0) {
+            // LL
+            rotateRight(node);
+        }
+        else if (BF_left == -1) {
+            // LR
+            rotateLeft(nodes[node].left);
+            rotateRight(node);
+        }
+    }
+    else if (BF == -2) {
+        int BF_right = getBalanceFactor(nodes[node].right);
+        if (BF_right <= 0) {
+            // RR
+            rotateLeft(node);
+        }
+        else if (BF_right == 1) {
+            // RL
+            rotateRight(nodes[node].right);
+            rotateLeft(node);
+        }
+    }
+}
+
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::rotateRight(int node) {
+    if (node == NULL_NODE)
+        return;
+
+    // save relevant indices
+    int parent = nodes[node].parent;
+    int B = node;
+    int A = nodes[node].left;
+    int A_R = nodes[A].right;
+
+    // change links accordingly
+    replaceSon(parent, B, A);
+    nodes[A].parent = parent;
+
+    nodes[B].left = A_R;
+    if (A_R != NULL_NODE)
+        nodes[A_R].parent = B;
+
+    nodes[A].right = B;
+    nodes[B].parent = A;
+
+    updateRanks(B);     // B is A's son now
+    updateRanks(A);
+}
+
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::rotateLeft(int node) {
+    if (node == NULL_NODE)
+        return;
+
+    // get relevant indices
+    int parent = nodes[node].parent;
+    int A = node;
+    int B = nodes[node].right;
+    int B_L = nodes[B].left;
+
+    // change links accordingly
+    replaceSon(parent, A, B);
+    nodes[B].parent = parent;
+
+    nodes[A].right = B_L;
+    if (B_L != NULL_NODE)
+        nodes[B_L].parent = A;
+
+    nodes[B].left = A;
+    nodes[A].parent = B;
+
+    updateRanks(A);     // A is B's son now
+    updateRanks(B);
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::replaceSon(int parent, int son, int newSon) {
+    // the root has no parent
+    if (parent == NULL_NODE) {
+        root = newSon;
+    }
+    else if (nodes[parent].left == son) {
+        nodes[parent].left = newSon;
+    }
+    else {
+        nodes[parent].right = newSon;
+    }
+}
+
+template<class Key, class Policy>
+int AugmentedAVL<Key, Policy>::getBalanceFactor(int node) const {
+    int left_height = -1, right_height = -1;
+
+    if (nodes[node].left != NULL_NODE) {
+        left_height = nodes[nodes[node].left].height;
+    }
+    if (nodes[node].right != NULL_NODE) {
+        right_height = nodes[nodes[node].right].height;
+    }
+
+    return (left_height - right_height);
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::updateRanks(int node) {
+    SetRanks(nodes, node);
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::SetRanks(Node* nodes, int node) {
+    Node& curr = nodes[node];
+
+    // If it's a leaf initialize accordingly (same values as in ctor)
+    if (curr.isLeaf()) {
+        curr.height = 0;
+        curr.aggregate = Policy::Of(curr.key);
+        curr.subTreeSize = 1;
+        return;
+    }
+
+    int left_height = -1, right_height = -1;
+    int left_size = 0, right_size = 0;
+    Aggregate aggregate = Policy::Of(curr.key);
+
+    // if left/right son exists, get their ranks (in order: left, this node, right)
+    if (curr.left != NULL_NODE) {
+        left_height = nodes[curr.left].height;
+        left_size = nodes[curr.left].subTreeSize;
+        aggregate = Policy::Combine(nodes[curr.left].aggregate, aggregate);
+    }
+    if (curr.right != NULL_NODE) {
+        right_height = nodes[curr.right].height;
+        right_size = nodes[curr.right].subTreeSize;
+        aggregate = Policy::Combine(aggregate, nodes[curr.right].aggregate);
+    }
+
+    // Calculate this node's rank based on sons' ranks
+    curr.height = ((left_height > right_height) ? left_height : right_height) + 1;
+    curr.subTreeSize = left_size + right_size + 1;
+    curr.aggregate = aggregate;
+}
+
+// this function is ONLY called from the COPY CTOR and ASSIGNMENT OPERATOR
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::CopyTree(const AugmentedAVL& other) {
+    if (other.size == 0) return;
+
+    // copy the pool as is, so the nodes keep their indices (and handles stay valid in the copy)
+    nodes = new Node[other.used];
+    for (int i = 0; i < other.used; i++) nodes[i] = other.nodes[i];
+    capacity = used = other.used;
+    freeNodes = other.freeNodes;
+    root = other.root;
+    size = other.size;
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::TakeOver(AugmentedAVL& other) {
+    nodes = other.nodes;
+    capacity = other.capacity;
+    used = other.used;
+    freeNodes = other.freeNodes;
+    root = other.root;
+    size = other.size;
+    other.nodes = nullptr;
+    other.capacity = other.used = other.size = 0;
+    other.freeNodes = other.root = NULL_NODE;
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::DestroyTree() {
+    // every node lives in the pool
+    delete[] nodes;
+    nodes = nullptr;
+}
+
+template<class Key, class Policy>
+int AugmentedAVL<Key, Policy>::AllocateNode(const Key& key, int parent) {
+    int node = freeNodes;
+    if (node != NULL_NODE) {
+        // reuse a removed node
+        freeNodes = nodes[node].right;
+    } else {
+        // take the next node of the pool, or grow the pool (the indices stay the same)
+        if (used == capacity) {
+            int newCapacity = (capacity < MIN_POOL_SIZE) ? MIN_POOL_SIZE : capacity + capacity / 2;
+            auto newNodes = new Node[newCapacity];
+            for (int i = 0; i < used; i++) newNodes[i] = nodes[i];
+            delete[] nodes;
+            nodes = newNodes;
+            capacity = newCapacity;
+        }
+        node = used++;
+    }
+
+    nodes[node] = Node(key, parent, Policy::Of(key));
+    return node;
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::FreeNode(int node) {
+    // the slot belongs to the pool, keep it for the next insert
+    nodes[node].right = freeNodes;
+    freeNodes = node;
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::AllocatePool(int poolCapacity) {
+    // only called on a tree without a pool
+    nodes = new Node[poolCapacity];
+    capacity = poolCapacity;
+    used = poolCapacity;    // the caller builds a tree over all of it
+}
+
+template<class Key, class Policy>
+template<class Source>
+int AugmentedAVL<Key, Policy>::BuildTree(Source& source, Node* nodes, int first, int last, int parent) {
+    if (first > last) return NULL_NODE;
+
+    // the middle key is the root, so the tree is balanced.
+    // the node of the i-th key is nodes[i], and the keys are taken in increasing order (inorder)
+    int middle = first + (last - first) / 2;
+
+    int left = BuildTree(source, nodes, first, middle - 1, middle);
+    const Key& key = source(middle);
+    nodes[middle] = Node(key, parent, Policy::Of(key));
+    nodes[middle].left = left;
+    nodes[middle].right = BuildTree(source, nodes, middle + 1, last, middle);
+
+    // postorder, so the sons' ranks are ready
+    SetRanks(nodes, middle);
+    return middle;
+}
+
+template<class Key, class Policy>
+template<class Source>
+int AugmentedAVL<Key, Policy>::BuildTreeParallel(Source& source, Node* nodes, int first, int last, int parent, int depth) {
+    if (depth == 0 || first > last) return BuildTree(source, nodes, first, last, parent);
+
+    int middle = first + (last - first) / 2;
+    int left = NULL_NODE, right = NULL_NODE;
+
+    // build the two subtrees at the same time (the source must allow random access)
+    ParallelFor(2, [&](int side) {
+        if (side == 0) {
+            left = BuildTreeParallel(source, nodes, first, middle - 1, middle, depth - 1);
+        } else {
+            right = BuildTreeParallel(source, nodes, middle + 1, last, middle, depth - 1);
+        }
+    });
+
+    const Key& key = source(middle);
+    nodes[middle] = Node(key, parent, Policy::Of(key));
+    nodes[middle].left = left;
+    nodes[middle].right = right;
+    SetRanks(nodes, middle);
+    return middle;
+}
+
+template<class Key, class Policy>
+AugmentedAVL<Key, Policy> AugmentedAVL<Key, Policy>::ParallelMergeRankTrees(const AugmentedAVL& a, const AugmentedAVL& b) {
+    int threadsNum = ParallelThreadsNum();
+    Key* aArray = nullptr;
+    Key* bArray = nullptr;
+    Key* helperArray = nullptr;
+    AugmentedAVL newTree;
+    try {
+        aArray = new Key[a.size];
+        bArray = new Key[b.size];
+        helperArray = new Key[a.size + b.size];
+
+        // inorder on both trees at the same time
+        ParallelFor(2, [&](int side) {
+            const AugmentedAVL& tree = (side == 0) ? a : b;
+            Key* array = (side == 0) ? aArray : bArray;
+            int i = 0;
+            for (auto iter = tree.begin(); iter != tree.end(); iter++, i++) array[i] = *iter;
+        });
+
+        // merge the two sorted arrays, every thread fills its own slice of the result
+        ParallelMerge(aArray, a.size, bArray, b.size, helperArray);
+        delete[] aArray;
+        delete[] bArray;
+        aArray = bArray = nullptr;
+
+        // build the tree, the top levels split the work between the threads
+        int depth = log(threadsNum);
+        auto sorted = [&](int i) -> const Key& { return helperArray[i]; };
+        newTree.AllocatePool(a.size + b.size);
+        newTree.root = BuildTreeParallel(sorted, newTree.nodes, 0, a.size + b.size - 1, NULL_NODE, depth);
+        newTree.size = a.size + b.size;
+    } catch (...) {
+        delete[] helperArray;
+        delete[] bArray;
+        delete[] aArray;
+        throw;
+    }
+
+    delete[] helperArray;
+    return newTree;
+}
+
+template<class Key, class Policy>
+void AugmentedAVL<Key, Policy>::ParallelMerge(const Key* a, int aSize, const Key* b, int bSize, Key* merged) {
+    int threadsNum = ParallelThreadsNum();
+    int total = aSize + bSize;
+
+    ParallelFor(threadsNum, [&](int t) {
+        // this thread fills merged[first..last)
+        int first = (int)((long)total * t / threadsNum), last = (int)((long)total * (t + 1) / threadsNum);
+        int i = CoRank(first, a, aSize, b, bSize), j = first - i;
+        int iEnd = CoRank(last, a, aSize, b, bSize), jEnd = last - iEnd;
+
+        int k = first;
+        while (i < iEnd && j < jEnd) merged[k++] = (a[i] < b[j]) ? a[i++] : b[j++];
+        while (i < iEnd) merged[k++] = a[i++];
+        while (j < jEnd) merged[k++] = b[j++];
+    });
+}
+
+template<class Key, class Policy>
+int AugmentedAVL<Key, Policy>::CoRank(int i, const Key* a, int aSize, const Key* b, int bSize) {
+    // how many of the first i merged keys come from a:
+    // the smallest j such that a[j] is bigger than b[i - j - 1]
+    int low = (i - bSize > 0) ? i - bSize : 0;
+    int high = (i < aSize) ? i : aSize;
+
+    while (low < high) {
+        int j = low + (high - low) / 2;
+        if (a[j] < b[i - j - 1]) {
+            low = j + 1;
+        } else {
+            high = j;
+        }
+    }
+
+    return low;
+}
+
+template<class Key, class Policy>
+int AugmentedAVL<Key, Policy>::log(int n) {
+    /*
+        wanted results:
+        1->0
+        2->1
+        3->1
+        4->2
+        5->2
+        6->2
+        7->2
+        8->3
+        ...
+    */
+
+    int res = 0;
+
+    while (n > 1) {
+        n /= 2;
+        res++;
+    }
+
+    return res;
+}
+
+#endif //DATACENTERS_WET2_AVL_H
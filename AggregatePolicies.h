@@ -0,0 +1,17 @@
+#ifndef DATACENTERS_WET2_AGGREGATEPOLICIES_H
+#define DATACENTERS_WET2_AGGREGATEPOLICIES_H
+
+#include "Server.h"
+
+// Aggregate policies for AugmentedAVL: what every node keeps about the server keys of its subtree.
+// A tree only pays for the policy it is instantiated with.
+
+// the total traffic (top-k sums)
+struct TrafficSum {
+    typedef int Aggregate;
+    static Aggregate Identity() { return 0; }
+    static Aggregate Of(const ServerKey& key) { return key.traffic; }
+    static Aggregate Combine(const Aggregate& lower, const Aggregate& higher) { return lower + higher; }
+};
+
+#endif //DATACENTERS_WET2_AGGREGATEPOLICIES_H
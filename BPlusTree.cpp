@@ -0,0 +1,598 @@
+#include <new>
+#include "BPlusTree.h"
+
+const int LEAF_MIN = BTREE_LEAF_SIZE / 2;      // a leaf or inner node other than the root never has less
+const int INNER_MIN = BTREE_INNER_SIZE / 2;
+const int MAX_HEIGHT = 32;     // far above what INT_MAX keys can reach
+
+BPlusTree::BPlusTree(const BPlusTree& other) : root(nullptr), height(0), size(0) {
+    auto keys = new ServerKey[other.size > 0 ? other.size : 1];
+    other.CopyKeys(keys);
+    try {
+        BPlusTree copy = BuildFromSorted(keys, other.size);
+        TakeOver(copy);
+    } catch (std::bad_alloc& ba) {
+        delete[] keys;
+        throw;
+    }
+    delete[] keys;
+}
+
+BPlusTree::BPlusTree(BPlusTree&& other) noexcept : root(nullptr), height(0), size(0) {
+    TakeOver(other);
+}
+
+BPlusTree& BPlusTree::operator=(const BPlusTree& other) {
+    if (this == &other) return *this;
+    BPlusTree copy(other);  // may throw - this tree is untouched then
+    DestroyHelp(root, height);
+    root = nullptr;
+    TakeOver(copy);
+    return *this;
+}
+
+BPlusTree& BPlusTree::operator=(BPlusTree&& other) noexcept {
+    if (this == &other) return *this;
+    DestroyHelp(root, height);
+    root = nullptr;
+    TakeOver(other);
+    return *this;
+}
+
+BPlusTree::~BPlusTree() {
+    DestroyHelp(root, height);
+}
+
+bool BPlusTree::find(const ServerKey& key) const {
+    if (root == nullptr) return false;
+
+    void* node = root;
+    for (int level = height; level > 0; level--) {
+        auto inner = (Inner*)node;
+        node = inner->children[ChildIndex(inner, key)];
+    }
+
+    auto leaf = (Leaf*)node;
+    int i = LowerBound(leaf, key);
+    return i < leaf->count && Equal(leaf->keys[i], key);
+}
+
+AVLResult BPlusTree::insert(const ServerKey& key) {
+    if (find(key)) return AVL_ALREADY_EXIST;
+
+    if (root == nullptr) {
+        auto leaf = new Leaf();
+        leaf->keys[0] = key;
+        leaf->count = 1;
+        root = leaf;
+        height = 0;
+        size = 1;
+        return AVL_SUCCESS;
+    }
+
+    // allocate every node the splits need before changing anything, so running out of memory leaves the tree as it was.
+    // the full nodes on the path, from the leaf up, are the ones that split: spare[level] takes the right half of the
+    // one at that level, and spare[height + 1] is the new root if they all do
+    bool full[MAX_HEIGHT + 1];
+    void* node = root;
+    for (int level = height; level > 0; level--) {
+        auto inner = (Inner*)node;
+        full[level] = inner->count == BTREE_INNER_SIZE;
+        node = inner->children[ChildIndex(inner, key)];
+    }
+    full[0] = ((Leaf*)node)->count == BTREE_LEAF_SIZE;
+
+    void* spare[MAX_HEIGHT + 2] = {};
+    try {
+        for (int level = 0; level <= height + 1; level++) {
+            if (level <= height && !full[level]) break;
+            if (level == 0) spare[level] = new Leaf();
+            else spare[level] = new Inner();
+        }
+    } catch (std::bad_alloc& ba) {
+        delete (Leaf*)spare[0];
+        for (int level = 1; level <= height + 1; level++) delete (Inner*)spare[level];
+        throw;
+    }
+
+    ServerKey separator;
+    void* sibling = InsertHelp(root, height, key, &separator, spare);
+    if (sibling != nullptr) {
+        // the root was split - grow a level
+        auto newRoot = (Inner*)spare[height + 1];
+        newRoot->children[0] = root;
+        newRoot->children[1] = sibling;
+        newRoot->separators[0] = separator;
+        newRoot->count = 2;
+        Aggregate(root, height, &newRoot->sizes[0], &newRoot->traffics[0]);
+        Aggregate(sibling, height, &newRoot->sizes[1], &newRoot->traffics[1]);
+        root = newRoot;
+        height++;
+    }
+    size++;
+    return AVL_SUCCESS;
+}
+
+AVLResult BPlusTree::remove(const ServerKey& key) {
+    if (root == nullptr || !RemoveHelp(root, height, key)) return AVL_NOT_EXIST;
+    size--;
+
+    if (height > 0 && ((Inner*)root)->count == 1) {
+        // the root has a single child left - shrink a level
+        auto oldRoot = (Inner*)root;
+        root = oldRoot->children[0];
+        height--;
+        delete oldRoot;
+    } else if (height == 0 && size == 0) {
+        delete (Leaf*)root;
+        root = nullptr;
+    }
+    return AVL_SUCCESS;
+}
+
+BPlusTree BPlusTree::MergeRankTrees(const BPlusTree& a, const BPlusTree& b) {
+    int totalSize = a.size + b.size;
+    auto aKeys = new ServerKey[a.size > 0 ? a.size : 1];
+    ServerKey* bKeys = nullptr;
+    ServerKey* merged;
+    try {
+        bKeys = new ServerKey[b.size > 0 ? b.size : 1];
+        merged = new ServerKey[totalSize > 0 ? totalSize : 1];
+    } catch (std::bad_alloc& ba) {
+        delete[] aKeys;
+        delete[] bKeys;
+        throw;
+    }
+    a.CopyKeys(aKeys);
+    b.CopyKeys(bKeys);
+
+    // merge the sorted arrays
+    int i = 0, j = 0, k = 0;
+    while (i < a.size && j < b.size) merged[k++] = (aKeys[i] < bKeys[j]) ? aKeys[i++] : bKeys[j++];
+    while (i < a.size) merged[k++] = aKeys[i++];
+    while (j < b.size) merged[k++] = bKeys[j++];
+    delete[] aKeys;
+    delete[] bKeys;
+
+    BPlusTree tree;
+    try {
+        tree = BuildFromSorted(merged, totalSize);
+    } catch (std::bad_alloc& ba) {
+        delete[] merged;
+        throw;
+    }
+    delete[] merged;
+    return tree;
+}
+
+int BPlusTree::SumHighestTrafficServers(int k) const {
+    if (k <= 0 || root == nullptr) return 0;
+
+    // take whole children from the right while they fit, and go down into the one that doesn't
+    int sum = 0;
+    void* node = root;
+    for (int level = height; level > 0; level--) {
+        auto inner = (Inner*)node;
+        int i = inner->count - 1;
+        for (; i >= 0; i--) {
+            if (inner->sizes[i] > k) break;
+            sum += inner->traffics[i];
+            k -= inner->sizes[i];
+            if (k == 0) return sum;
+        }
+        if (i < 0) return sum;  // less than k servers in the tree
+        node = inner->children[i];
+    }
+
+    auto leaf = (Leaf*)node;
+    for (int i = leaf->count - 1; i >= 0 && k > 0; i--, k--) sum += leaf->keys[i].traffic;
+    return sum;
+}
+
+void BPlusTree::TrafficAtLeast(int traffic, int* count, int* sum) const {
+    *count = *sum = 0;
+    if (root == nullptr) return;
+
+    // the children right of the one the bound falls in are taken whole
+    ServerKey bound(traffic, 0);    // below every key with this traffic
+    void* node = root;
+    for (int level = height; level > 0; level--) {
+        auto inner = (Inner*)node;
+        int i = ChildIndex(inner, bound);
+        for (int j = i + 1; j < inner->count; j++) {
+            *count += inner->sizes[j];
+            *sum += inner->traffics[j];
+        }
+        node = inner->children[i];
+    }
+
+    auto leaf = (Leaf*)node;
+    for (int i = LowerBound(leaf, bound); i < leaf->count; i++) {
+        (*count)++;
+        *sum += leaf->keys[i].traffic;
+    }
+}
+
+ServerKey BPlusTree::SelectHighest(int k) const {
+    // skip whole children from the right, and go down into the one that has the key
+    void* node = root;
+    for (int level = height; level > 0; level--) {
+        auto inner = (Inner*)node;
+        int i = inner->count - 1;
+        while (k > inner->sizes[i]) k -= inner->sizes[i--];
+        node = inner->children[i];
+    }
+
+    auto leaf = (Leaf*)node;
+    return leaf->keys[leaf->count - k];
+}
+
+int BPlusTree::HighestTraffics(int k, int* traffics) const {
+    int count = 0;
+    HighestTrafficsHelp(root, height, k, traffics, &count);
+    return count;
+}
+
+BPlusTree BPlusTree::BuildFromSorted(const ServerKey* sorted, int count) {
+    BPlusTree tree;
+    if (count == 0) return tree;
+
+    // bottom up: spread the keys evenly over as few leaves as possible, then the nodes of every level
+    // evenly over as few parents as possible, so every node other than the root is at least half full.
+    // the parents of a level overwrite the children they took in nodes[]
+    int nodesNum = (count + BTREE_LEAF_SIZE - 1) / BTREE_LEAF_SIZE;
+    auto nodes = new void*[nodesNum];
+    auto mins = new ServerKey[nodesNum];    // the smallest key under every node of the current level
+    int level = 0, built = 0, first = 0;    // built nodes of the next level, and the first child not taken yet
+    bool leavesDone = false;
+    try {
+        for (; built < nodesNum; built++) {
+            int leafSize = count / nodesNum + (built < count % nodesNum ? 1 : 0);
+            auto leaf = new Leaf();
+            for (int j = 0; j < leafSize; j++) leaf->keys[j] = sorted[first + j];
+            leaf->count = leafSize;
+            nodes[built] = leaf;
+            mins[built] = sorted[first];
+            first += leafSize;
+        }
+        leavesDone = true;
+
+        while (nodesNum > 1) {
+            int parentsNum = (nodesNum + BTREE_INNER_SIZE - 1) / BTREE_INNER_SIZE;
+            built = 0;
+            first = 0;
+            for (; built < parentsNum; built++) {
+                int childrenNum = nodesNum / parentsNum + (built < nodesNum % parentsNum ? 1 : 0);
+                auto inner = new Inner();
+                for (int j = 0; j < childrenNum; j++) {
+                    inner->children[j] = nodes[first + j];
+                    Aggregate(nodes[first + j], level, &inner->sizes[j], &inner->traffics[j]);
+                    if (j > 0) inner->separators[j - 1] = mins[first + j];
+                }
+                inner->count = childrenNum;
+                nodes[built] = inner;
+                mins[built] = mins[first];
+                first += childrenNum;
+            }
+            nodesNum = parentsNum;
+            level++;
+        }
+    } catch (std::bad_alloc& ba) {
+        if (!leavesDone) {
+            for (int i = 0; i < built; i++) DestroyHelp(nodes[i], 0);
+        } else {
+            for (int i = 0; i < built; i++) DestroyHelp(nodes[i], level + 1);
+            for (int i = first; i < nodesNum; i++) DestroyHelp(nodes[i], level);
+        }
+        delete[] mins;
+        delete[] nodes;
+        throw;
+    }
+
+    tree.root = nodes[0];
+    tree.height = level;
+    tree.size = count;
+    delete[] mins;
+    delete[] nodes;
+    return tree;
+}
+
+void BPlusTree::CopyKeys(ServerKey* keys) const {
+    int i = 0;
+    ForEach([&](const ServerKey& key) { keys[i++] = key; });
+}
+
+//--------------------------- PRIVATE FUNCTIONS -----------------------
+
+void* BPlusTree::InsertHelp(void* node, int level, const ServerKey& key, ServerKey* separator, void** spare) {
+    if (level == 0) {
+        auto leaf = (Leaf*)node;
+        int position = LowerBound(leaf, key);
+
+        if (leaf->count < BTREE_LEAF_SIZE) {
+            for (int i = leaf->count; i > position; i--) leaf->keys[i] = leaf->keys[i - 1];
+            leaf->keys[position] = key;
+            leaf->count++;
+            return nullptr;
+        }
+
+        // full - move the upper half to a new leaf, then insert into the right half
+        auto right = (Leaf*)spare[0];
+        int half = (BTREE_LEAF_SIZE + 1) / 2;
+        for (int i = half; i < BTREE_LEAF_SIZE; i++) right->keys[i - half] = leaf->keys[i];
+        right->count = BTREE_LEAF_SIZE - half;
+        leaf->count = half;
+
+        Leaf* target = leaf;
+        if (position > half || (position == half && right->count < leaf->count)) {
+            target = right;
+            position -= half;
+        }
+        for (int i = target->count; i > position; i--) target->keys[i] = target->keys[i - 1];
+        target->keys[position] = key;
+        target->count++;
+
+        *separator = right->keys[0];
+        return right;
+    }
+
+    auto inner = (Inner*)node;
+    int child = ChildIndex(inner, key);
+    ServerKey childSeparator;
+    void* sibling = InsertHelp(inner->children[child], level - 1, key, &childSeparator, spare);
+
+    if (sibling == nullptr) {
+        inner->sizes[child]++;
+        inner->traffics[child] += key.traffic;
+        return nullptr;
+    }
+
+    int siblingSize, siblingTraffic;
+    Aggregate(sibling, level - 1, &siblingSize, &siblingTraffic);
+
+    if (inner->count < BTREE_INNER_SIZE) {
+        for (int i = inner->count; i > child + 1; i--) {
+            inner->children[i] = inner->children[i - 1];
+            inner->sizes[i] = inner->sizes[i - 1];
+            inner->traffics[i] = inner->traffics[i - 1];
+            inner->separators[i - 1] = inner->separators[i - 2];
+        }
+        inner->children[child + 1] = sibling;
+        inner->sizes[child + 1] = siblingSize;
+        inner->traffics[child + 1] = siblingTraffic;
+        inner->separators[child] = childSeparator;
+        inner->count++;
+        Aggregate(inner->children[child], level - 1, &inner->sizes[child], &inner->traffics[child]);
+        return nullptr;
+    }
+
+    // full - lay the children out with the new one, and split them in half
+    void* children[BTREE_INNER_SIZE + 1];
+    int sizes[BTREE_INNER_SIZE + 1], traffics[BTREE_INNER_SIZE + 1];
+    ServerKey separators[BTREE_INNER_SIZE];
+    Aggregate(inner->children[child], level - 1, &inner->sizes[child], &inner->traffics[child]);
+    for (int i = 0, j = 0; i < BTREE_INNER_SIZE; i++, j++) {
+        children[j] = inner->children[i];
+        sizes[j] = inner->sizes[i];
+        traffics[j] = inner->traffics[i];
+        if (i > 0) separators[j - 1] = inner->separators[i - 1];
+        if (i == child) {
+            j++;
+            children[j] = sibling;
+            sizes[j] = siblingSize;
+            traffics[j] = siblingTraffic;
+            separators[j - 1] = childSeparator;
+        }
+    }
+
+    auto right = (Inner*)spare[level];
+    int half = (BTREE_INNER_SIZE + 1) / 2;
+    for (int i = 0; i < half; i++) {
+        inner->children[i] = children[i];
+        inner->sizes[i] = sizes[i];
+        inner->traffics[i] = traffics[i];
+        if (i > 0) inner->separators[i - 1] = separators[i - 1];
+    }
+    inner->count = half;
+    for (int i = half; i <= BTREE_INNER_SIZE; i++) {
+        right->children[i - half] = children[i];
+        right->sizes[i - half] = sizes[i];
+        right->traffics[i - half] = traffics[i];
+        if (i > half) right->separators[i - half - 1] = separators[i - 1];
+    }
+    right->count = BTREE_INNER_SIZE + 1 - half;
+
+    *separator = separators[half - 1];
+    return right;
+}
+
+bool BPlusTree::RemoveHelp(void* node, int level, const ServerKey& key) {
+    if (level == 0) {
+        auto leaf = (Leaf*)node;
+        int position = LowerBound(leaf, key);
+        if (position == leaf->count || !Equal(leaf->keys[position], key)) return false;
+
+        for (int i = position; i < leaf->count - 1; i++) leaf->keys[i] = leaf->keys[i + 1];
+        leaf->count--;
+        return true;
+    }
+
+    auto inner = (Inner*)node;
+    int child = ChildIndex(inner, key);
+    if (!RemoveHelp(inner->children[child], level - 1, key)) return false;
+
+    inner->sizes[child]--;
+    inner->traffics[child] -= key.traffic;
+    if (Count(inner->children[child], level - 1) < (level == 1 ? LEAF_MIN : INNER_MIN)) Rebalance(inner, child, level);
+    return true;
+}
+
+void BPlusTree::Rebalance(Inner* parent, int child, int level) {
+    // join the child with a sibling, or share the sibling's entries with it
+    int left = (child > 0) ? child - 1 : child;
+    int right = left + 1;
+    int maxCount = (level == 1) ? BTREE_LEAF_SIZE : BTREE_INNER_SIZE;
+    int total = Count(parent->children[left], level - 1) + Count(parent->children[right], level - 1);
+
+    if (level == 1) {
+        auto a = (Leaf*)parent->children[left], b = (Leaf*)parent->children[right];
+        if (total <= maxCount) {
+            for (int i = 0; i < b->count; i++) a->keys[a->count + i] = b->keys[i];
+            a->count = total;
+            delete b;
+            RemoveChild(parent, right);
+        } else {
+            ServerKey keys[2 * BTREE_LEAF_SIZE];
+            for (int i = 0; i < a->count; i++) keys[i] = a->keys[i];
+            for (int i = 0; i < b->count; i++) keys[a->count + i] = b->keys[i];
+            int half = total / 2;
+            for (int i = 0; i < half; i++) a->keys[i] = keys[i];
+            for (int i = half; i < total; i++) b->keys[i - half] = keys[i];
+            a->count = half;
+            b->count = total - half;
+            parent->separators[left] = b->keys[0];
+        }
+    } else {
+        auto a = (Inner*)parent->children[left], b = (Inner*)parent->children[right];
+        if (total <= maxCount) {
+            a->separators[a->count - 1] = parent->separators[left];
+            for (int i = 0; i < b->count; i++) {
+                a->children[a->count + i] = b->children[i];
+                a->sizes[a->count + i] = b->sizes[i];
+                a->traffics[a->count + i] = b->traffics[i];
+                if (i > 0) a->separators[a->count + i - 1] = b->separators[i - 1];
+            }
+            a->count = total;
+            delete b;
+            RemoveChild(parent, right);
+        } else {
+            // the parent's separator goes between the two runs of children
+            void* children[2 * BTREE_INNER_SIZE];
+            int sizes[2 * BTREE_INNER_SIZE], traffics[2 * BTREE_INNER_SIZE];
+            ServerKey separators[2 * BTREE_INNER_SIZE];
+            int n = 0;
+            for (int i = 0; i < a->count; i++, n++) {
+                children[n] = a->children[i];
+                sizes[n] = a->sizes[i];
+                traffics[n] = a->traffics[i];
+                if (i > 0) separators[n - 1] = a->separators[i - 1];
+            }
+            separators[n - 1] = parent->separators[left];
+            for (int i = 0; i < b->count; i++, n++) {
+                children[n] = b->children[i];
+                sizes[n] = b->sizes[i];
+                traffics[n] = b->traffics[i];
+                if (i > 0) separators[n - 1] = b->separators[i - 1];
+            }
+
+            int half = total / 2;
+            for (int i = 0; i < half; i++) {
+                a->children[i] = children[i];
+                a->sizes[i] = sizes[i];
+                a->traffics[i] = traffics[i];
+                if (i > 0) a->separators[i - 1] = separators[i - 1];
+            }
+            for (int i = half; i < total; i++) {
+                b->children[i - half] = children[i];
+                b->sizes[i - half] = sizes[i];
+                b->traffics[i - half] = traffics[i];
+                if (i > half) b->separators[i - half - 1] = separators[i - 1];
+            }
+            a->count = half;
+            b->count = total - half;
+            parent->separators[left] = separators[half - 1];
+        }
+    }
+
+    Aggregate(parent->children[left], level - 1, &parent->sizes[left], &parent->traffics[left]);
+    if (total > maxCount) Aggregate(parent->children[right], level - 1, &parent->sizes[right], &parent->traffics[right]);
+}
+
+void BPlusTree::RemoveChild(Inner* parent, int child) {
+    // child > 0, so the separator before it goes with it
+    for (int i = child; i < parent->count - 1; i++) {
+        parent->children[i] = parent->children[i + 1];
+        parent->sizes[i] = parent->sizes[i + 1];
+        parent->traffics[i] = parent->traffics[i + 1];
+        parent->separators[i - 1] = parent->separators[i];
+    }
+    parent->count--;
+}
+
+void BPlusTree::Aggregate(void* node, int level, int* size, int* traffic) {
+    int nodeSize = 0, nodeTraffic = 0;
+    if (level == 0) {
+        auto leaf = (Leaf*)node;
+        nodeSize = leaf->count;
+        for (int i = 0; i < leaf->count; i++) nodeTraffic += leaf->keys[i].traffic;
+    } else {
+        auto inner = (Inner*)node;
+        for (int i = 0; i < inner->count; i++) {
+            nodeSize += inner->sizes[i];
+            nodeTraffic += inner->traffics[i];
+        }
+    }
+    *size = nodeSize;
+    *traffic = nodeTraffic;
+}
+
+int BPlusTree::Count(void* node, int level) {
+    return (level == 0) ? ((Leaf*)node)->count : ((Inner*)node)->count;
+}
+
+int BPlusTree::ChildIndex(const Inner* inner, const ServerKey& key) {
+    // the number of separators that are <= key
+    int i = 0;
+    while (i < inner->count - 1 && !(key < inner->separators[i])) i++;
+    return i;
+}
+
+int BPlusTree::LowerBound(const Leaf* leaf, const ServerKey& key) {
+    int low = 0, high = leaf->count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (leaf->keys[middle] < key) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+bool BPlusTree::Equal(const ServerKey& a, const ServerKey& b) {
+    return !(a < b) && !(b < a);
+}
+
+void BPlusTree::TakeOver(BPlusTree& other) {
+    root = other.root;
+    height = other.height;
+    size = other.size;
+    other.root = nullptr;
+    other.height = 0;
+    other.size = 0;
+}
+
+void BPlusTree::DestroyHelp(void* node, int level) {
+    if (node == nullptr) return;
+
+    if (level == 0) {
+        delete (Leaf*)node;
+        return;
+    }
+
+    auto inner = (Inner*)node;
+    for (int i = 0; i < inner->count; i++) DestroyHelp(inner->children[i], level - 1);
+    delete inner;
+}
+
+void BPlusTree::HighestTrafficsHelp(void* node, int level, int k, int* traffics, int* count) {
+    // backward inorder, until k traffics are taken
+    if (node == nullptr) return;
+
+    if (level == 0) {
+        auto leaf = (Leaf*)node;
+        for (int i = leaf->count - 1; i >= 0 && *count < k; i--) traffics[(*count)++] = leaf->keys[i].traffic;
+        return;
+    }
+
+    auto inner = (Inner*)node;
+    for (int i = inner->count - 1; i >= 0 && *count < k; i--) HighestTrafficsHelp(inner->children[i], level - 1, k, traffics, count);
+}
@@ -0,0 +1,120 @@
+#ifndef DATACENTERS_WET2_BPLUSTREE_H
+#define DATACENTERS_WET2_BPLUSTREE_H
+
+#include "AVL.h"
+
+// sizes are chosen so a leaf is 4 cache lines and an inner node is 6 cache lines
+const int BTREE_LEAF_SIZE = 31;     // keys in a leaf
+const int BTREE_INNER_SIZE = 16;    // children of an inner node
+
+// An order-statistic B+-tree over server keys, with the same interface as the AVL rank tree.
+// Leaves hold sorted keys only (no parent pointers, no per-key ranks). Every inner node keeps
+// the number of servers and the total traffic of each of its children next to the child pointers,
+// so a top-k descent reads a few wide nodes instead of chasing one pointer per level of a binary tree.
+class BPlusTree {
+public:
+    BPlusTree() : root(nullptr), height(0), size(0) {}
+    BPlusTree(const BPlusTree& other);
+    BPlusTree(BPlusTree&& other) noexcept;
+    BPlusTree& operator=(const BPlusTree& other);
+    BPlusTree& operator=(BPlusTree&& other) noexcept;
+    ~BPlusTree();
+
+    bool find(const ServerKey& key) const;
+    AVLResult insert(const ServerKey& key);
+    AVLResult remove(const ServerKey& key);
+    static BPlusTree MergeRankTrees(const BPlusTree& a, const BPlusTree& b);
+    int SumHighestTrafficServers(int k) const;
+    void TrafficAtLeast(int traffic, int* count, int* sum) const;   // the keys with at least this traffic
+    ServerKey SelectHighest(int k) const;   // the k-th highest key, 1 <= k <= size
+    int Size() const { return size; }
+    int HighestTraffics(int k, int* traffics) const;   // the k highest traffics, descending. returns how many
+
+    template<class Function>
+    void ForEach(Function function) const { ForEachHelp(root, height, function); }   // ascending order
+    // calls function(key) on the keys that aren't bigger than upper (on all of them if upper is nullptr),
+    // in descending order, while it returns true
+    template<class Function>
+    void ForEachDown(const ServerKey* upper, Function function) const { ForEachDownHelp(root, height, upper, function); }
+
+    static BPlusTree BuildFromSorted(const ServerKey* sorted, int count);
+    void CopyKeys(ServerKey* keys) const;   // all the keys, ascending
+
+private:
+    struct Leaf {
+        ServerKey keys[BTREE_LEAF_SIZE];
+        int count;
+    };
+
+    struct Inner {
+        void* children[BTREE_INNER_SIZE];
+        int sizes[BTREE_INNER_SIZE];        // servers in each child's subtree
+        int traffics[BTREE_INNER_SIZE];     // total traffic of each child's subtree
+        ServerKey separators[BTREE_INNER_SIZE - 1];    // child i holds the keys in [separators[i-1], separators[i])
+        int count;
+    };
+
+    void* root;     // a Leaf if height == 0, otherwise an Inner
+    int height;
+    int size;
+
+    // spare[level] is the preallocated right half if the node of that level splits (see insert)
+    static void* InsertHelp(void* node, int level, const ServerKey& key, ServerKey* separator, void** spare);
+    static bool RemoveHelp(void* node, int level, const ServerKey& key);
+    static void Rebalance(Inner* parent, int child, int level);
+    static void RemoveChild(Inner* parent, int child);
+    static void Aggregate(void* node, int level, int* size, int* traffic);
+    static int Count(void* node, int level);
+    static int ChildIndex(const Inner* inner, const ServerKey& key);
+    static int LowerBound(const Leaf* leaf, const ServerKey& key);
+    static bool Equal(const ServerKey& a, const ServerKey& b);
+    void TakeOver(BPlusTree& other);    // other is left empty
+    static void DestroyHelp(void* node, int level);
+    static void HighestTrafficsHelp(void* node, int level, int k, int* traffics, int* count);
+
+    template<class Function>
+    static void ForEachHelp(void* node, int level, Function& function);
+    template<class Function>
+    static bool ForEachDownHelp(void* node, int level, const ServerKey* upper, Function& function);
+};
+
+template<class Function>
+void BPlusTree::ForEachHelp(void* node, int level, Function& function) {
+    if (node == nullptr) return;
+
+    if (level == 0) {
+        auto leaf = (Leaf*)node;
+        for (int i = 0; i < leaf->count; i++) function(leaf->keys[i]);
+        return;
+    }
+
+    auto inner = (Inner*)node;
+    for (int i = 0; i < inner->count; i++) ForEachHelp(inner->children[i], level - 1, function);
+}
+
+template<class Function>
+bool BPlusTree::ForEachDownHelp(void* node, int level, const ServerKey* upper, Function& function) {
+    // returns false once function asked to stop
+    if (node == nullptr) return true;
+
+    if (level == 0) {
+        auto leaf = (Leaf*)node;
+        int i = leaf->count - 1;
+        while (upper && i >= 0 && *upper < leaf->keys[i]) i--;
+        for (; i >= 0; i--) {
+            if (!function(leaf->keys[i])) return false;
+        }
+        return true;
+    }
+
+    // only the child the bound falls in is bounded, the ones left of it are taken whole
+    auto inner = (Inner*)node;
+    int i = upper ? ChildIndex(inner, *upper) : inner->count - 1;
+    if (!ForEachDownHelp(inner->children[i], level - 1, upper, function)) return false;
+    for (i--; i >= 0; i--) {
+        if (!ForEachDownHelp(inner->children[i], level - 1, nullptr, function)) return false;
+    }
+    return true;
+}
+
+#endif //DATACENTERS_WET2_BPLUSTREE_H
@@ -0,0 +1,90 @@
+#ifndef DATACENTERS_WET2_CHUNKEDARRAY_H
+#define DATACENTERS_WET2_CHUNKEDARRAY_H
+
+#include <new>
+
+const int CHUNK_BITS = 12;
+const int CHUNK_SIZE = 1 << CHUNK_BITS;     // elements in a chunk
+
+// An array of fixed size chunks that are allocated the first time one of their elements is written.
+// Reading an element of a chunk that was never written gives the initial value, so a big array
+// that is mostly untouched only costs its chunk directory (a pointer per CHUNK_SIZE elements).
+// Elements never move, so references to them stay valid, also when the array grows:
+// growing only allocates a bigger directory (doubling it) and copies the chunk pointers.
+template <class DataType>
+class ChunkedArray {
+public:
+    explicit ChunkedArray(int size, const DataType& initial = DataType());
+    ~ChunkedArray();
+    ChunkedArray(const ChunkedArray& other) = delete;
+    ChunkedArray& operator=(const ChunkedArray& other) = delete;
+
+    DataType Get(int i) const;      // doesn't allocate
+    DataType& operator[](int i);    // allocates the element's chunk if needed
+    int Size() const { return size; }
+    void Grow(int newSize);         // the new elements have the initial value
+    template<class Function>
+    void ForEach(Function function);    // calls function(i, element) for every element of an allocated chunk
+
+private:
+    DataType** chunks;  // nullptr for a chunk that was never written
+    int chunksNum;      // the size of the directory
+    int size;
+    DataType initial;
+};
+
+template<class DataType>
+ChunkedArray<DataType>::ChunkedArray(int size, const DataType& initial) :
+        chunks(nullptr), chunksNum((size + CHUNK_SIZE - 1) / CHUNK_SIZE), size(size), initial(initial) {
+    chunks = new DataType*[chunksNum > 0 ? chunksNum : 1]();
+}
+
+template<class DataType>
+ChunkedArray<DataType>::~ChunkedArray() {
+    for (int i = 0; i < chunksNum; i++) delete[] chunks[i];
+    delete[] chunks;
+}
+
+template<class DataType>
+DataType ChunkedArray<DataType>::Get(int i) const {
+    DataType* chunk = chunks[i >> CHUNK_BITS];
+    return chunk ? chunk[i & (CHUNK_SIZE - 1)] : initial;
+}
+
+template<class DataType>
+DataType& ChunkedArray<DataType>::operator[](int i) {
+    DataType*& chunk = chunks[i >> CHUNK_BITS];
+    if (!chunk) {
+        auto newChunk = new DataType[CHUNK_SIZE];
+        for (int j = 0; j < CHUNK_SIZE; j++) newChunk[j] = initial;
+        chunk = newChunk;
+    }
+    return chunk[i & (CHUNK_SIZE - 1)];
+}
+
+template<class DataType>
+void ChunkedArray<DataType>::Grow(int newSize) {
+    if (newSize <= size) return;
+
+    int neededChunks = (newSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (neededChunks > chunksNum) {
+        int newChunksNum = (neededChunks > 2 * chunksNum) ? neededChunks : 2 * chunksNum;
+        auto newChunks = new DataType*[newChunksNum]();
+        for (int i = 0; i < chunksNum; i++) newChunks[i] = chunks[i];
+        delete[] chunks;
+        chunks = newChunks;
+        chunksNum = newChunksNum;
+    }
+    size = newSize;
+}
+
+template<class DataType>
+template<class Function>
+void ChunkedArray<DataType>::ForEach(Function function) {
+    for (int c = 0; c < chunksNum; c++) {
+        if (!chunks[c]) continue;
+        for (int j = 0; j < CHUNK_SIZE && c * CHUNK_SIZE + j < size; j++) function(c * CHUNK_SIZE + j, chunks[c][j]);
+    }
+}
+
+#endif //DATACENTERS_WET2_CHUNKEDARRAY_H
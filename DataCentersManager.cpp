@@ -1,7 +1,49 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
 #include "DataCentersManager.h"
+#include "Parallel.h"
+#include "MergeSort.h"
+
+const int SNAPSHOT_CHUNK_SIZE = 4096;   // how many entries are written/read with one system call
+
+DataCentersManager::DataCentersManager(int size, RankTreeEngine rankTree, bool lazyMerge, bool approximate,
+                                       int windowEpochs) :
+        servers(approximate ? RANK_HISTOGRAM : rankTree),
+        ids(size),
+        dataCenterNum(size),
+        rankTree(rankTree),
+        dataCenters(size, nullptr),
+        lazyMerge(lazyMerge),
+        parts(size),
+        journal(nullptr),
+        shared(nullptr),
+        engine(nullptr),
+        topPrefix(0),
+        writeBuffer(0),
+        subscriptions(0),
+        subscriptionsNum(0),
+        freeSubscriptions(-1),
+        subscribers(size, -1),
+        globalSubscribers(-1),
+        windowEpochs(windowEpochs),
+        epoch(0),
+        windows(),
+        epochServers() {}
+
+DataCentersManager::~DataCentersManager() {
+    dataCenters.ForEach([](int, DataCenter* center) { delete center; });
+    for (auto& epochList : epochServers) delete[] epochList.serverIDs;
+    delete journal;
+    delete shared;
+    delete engine;
+}
 
 ManagerResult DataCentersManager::MergeDataCenters(DataCenterID dataCenter1, DataCenterID dataCenter2) {
+    if (engine) return (ManagerResult)engine->MergeDataCenters(dataCenter1, dataCenter2);
     if (dataCenter1 <= 0 || dataCenter1 > dataCenterNum || dataCenter2 <= 0 || dataCenter2 > dataCenterNum) return M_INVALID_INPUT;
+    if (journal && journal->Reserve(1) != J_SUCCESS) return M_FAILURE;   // writes stop while the journal isn't durable
 
     // get from union-find the indices of the data centers
     int center1InArray = ids.Find(dataCenter1), center2InArray = ids.Find(dataCenter2);
@@ -9,38 +51,91 @@ ManagerResult DataCentersManager::MergeDataCenters(DataCenterID dataCenter1, Dat
     // if they are already united, just return SUCCESS
     if (center1InArray == center2InArray) return M_SUCCESS;
 
-    // merge the two DataCenters into one new DataCenter
-    DataCenter newDataCenter = ServersManager::MergeServers(dataCenters[center1InArray], dataCenters[center2InArray]);
+    // the subscriptions move to the new root, its cell must exist before anything changes
+    if (subscribers.Get(center1InArray) != -1 || subscribers.Get(center2InArray) != -1) {
+        subscribers[center1InArray];
+        subscribers[center2InArray];
+    }
+
+    if (lazyMerge) {
+        // the servers stay in their parts until there are too many of them
+        int root = LinkParts(center1InArray, center2InArray);
+        UniteSubscribers(center1InArray, center2InArray, root);
+        if (journal) journal->Append(J_MERGE_DATA_CENTERS, dataCenter1, dataCenter2);
+        if (parts.Get(root).count > LAZY_MERGE_MAX_PARTS) Consolidate(root);   // if it fails, the parts stay linked
+        Notify(root);
+        return M_SUCCESS;
+    }
 
-    // clear the old data centers
-    DataCenter dummy;
-    dataCenters[center1InArray] = dummy;
-    dataCenters[center2InArray] = dummy;
+    // merge the two DataCenters into one new DataCenter. a data center without servers has no state
+    DataCenter* center1 = dataCenters.Get(center1InArray), * center2 = dataCenters.Get(center2InArray);
+    DataCenter* newDataCenter = center1 ? center1 : center2;
+    if (center1 && center2) {
+        center1->Flush();
+        center2->Flush();
+        newDataCenter = new DataCenter(ServersManager::MergeServers(*center1, *center2));
+    }
 
     // union the two sets in the union-find and get the new index
-    int newIndex = ids.Union(center1InArray, center2InArray);
+    int newIndex;
+    try {
+        if (newDataCenter) {
+            // the root's slot must exist before anything changes
+            dataCenters[center1InArray];
+            dataCenters[center2InArray];
+        }
+        newIndex = ids.Union(center1InArray, center2InArray);
+    } catch (std::bad_alloc& ba) {
+        if (center1 && center2) delete newDataCenter;
+        throw;
+    }
 
-    // put the new DataCenter in the array
-    dataCenters[newIndex] = newDataCenter;
+    // release the old data centers, and put the new DataCenter in the root's slot
+    if (center1 && center2) {
+        delete center1;
+        delete center2;
+    }
+    if (newDataCenter) {
+        dataCenters[center1InArray] = dataCenters[center2InArray] = nullptr;
+        dataCenters[newIndex] = newDataCenter;
+    }
+    UniteSubscribers(center1InArray, center2InArray, newIndex);
 
+    if (journal) journal->Append(J_MERGE_DATA_CENTERS, dataCenter1, dataCenter2);
+    Notify(newIndex);
     return M_SUCCESS;
 }
 
 ManagerResult DataCentersManager::AddServer(DataCenterID dataCenterID, ServerID serverID) {
+    if (engine) return (ManagerResult)engine->AddServer(dataCenterID, serverID);
     if (dataCenterID <= 0 || dataCenterID > dataCenterNum || serverID <= 0) return M_INVALID_INPUT;
+    if (journal && journal->Reserve(1) != J_SUCCESS) return M_FAILURE;
+    if (servers.GetDataCenterID(serverID) != 0) return M_FAILURE;  // already exists
 
-    // insert server to the main ServersManager, if already exist return FAILURE
+    // the data center's state is created with its first server
+    int dataCenterIDX = ids.Find(dataCenterID);
+    DataCenter*& dataCenter = dataCenters[dataCenterIDX];
+    if (!dataCenter) {
+        dataCenter = new DataCenter(rankTree);
+        dataCenter->KeepTopPrefix(topPrefix);
+        dataCenter->BufferWrites(writeBuffer);
+    }
+
+    // insert server to the main ServersManager
     if (servers.AddServer(dataCenterID, serverID) != SM_SUCCESS) return M_FAILURE;
 
     // insert server to the specific data center. in fact, it should always return SM_SUCCESS
-    int dataCenterIDX = ids.Find(dataCenterID);
-    if (dataCenters[dataCenterIDX].AddServer(dataCenterID,serverID) != SM_SUCCESS) return M_FAILURE;
+    if (dataCenter->AddServer(dataCenterID,serverID) != SM_SUCCESS) return M_FAILURE;
+    if (windowEpochs) windows.Insert(serverID, TrafficWindow());
 
+    if (journal) journal->Append(J_ADD_SERVER, dataCenterID, serverID);
     return M_SUCCESS;
 }
 
 ManagerResult DataCentersManager::RemoveServer(ServerID serverID) {
+    if (engine) return (ManagerResult)engine->RemoveServer(serverID);
     if (serverID <= 0) return M_INVALID_INPUT;
+    if (journal && journal->Reserve(1) != J_SUCCESS) return M_FAILURE;
 
     // get data center ID
     int dataCenterID = servers.GetDataCenterID(serverID);
@@ -51,13 +146,32 @@ ManagerResult DataCentersManager::RemoveServer(ServerID serverID) {
     if (servers.RemoveServer(serverID) != SM_SUCCESS) return M_FAILURE;
 
     // remove the server from the data center
-    if (dataCenters[dataCenterIDX].RemoveServer(serverID) != SM_SUCCESS) return M_FAILURE;
+    if (PartOf(dataCenterIDX, serverID)->RemoveServer(serverID) != SM_SUCCESS) return M_FAILURE;
+    if (windowEpochs) windows.Delete(serverID);     // its entries in the epoch lists are skipped from now on
 
+    if (journal) journal->Append(J_REMOVE_SERVER, serverID, 0);
+    Notify(-1);
+    Notify(dataCenterIDX);
     return M_SUCCESS;
 }
 
 ManagerResult DataCentersManager::SetTraffic(ServerID serverID, int traffic) {
+    if (engine) return (ManagerResult)engine->SetTraffic(serverID, traffic);
     if (serverID <= 0 || traffic < 0) return M_INVALID_INPUT;
+    if (journal && journal->Reserve(1) != J_SUCCESS) return M_FAILURE;
+
+    // windowed: the traffic of the current epoch, the rank trees get the window's new total
+    TrafficWindow* window = nullptr;
+    int epochTraffic = traffic;
+    if (windowEpochs) {
+        if (!windows.Contains(serverID)) return M_FAILURE;     // server doesn't exist
+        window = &windows.Find(serverID);
+        int slot = epoch % windowEpochs;
+        long long total = (long long)window->total - window->traffics[slot] + traffic;
+        if (total > INT_MAX) return M_INVALID_INPUT;
+        if (window->traffics[slot] == 0 && traffic != 0) AddToEpoch(slot, serverID);
+        traffic = (int)total;
+    }
 
     // set traffic in main ServerManager
     if (servers.SetTraffic(serverID, traffic) != SM_SUCCESS) return M_FAILURE;
@@ -68,20 +182,938 @@ ManagerResult DataCentersManager::SetTraffic(ServerID serverID, int traffic) {
     int dataCenterIDX = ids.Find(dataCenterID);
 
     // set traffic in DataCenter
-    if (dataCenters[dataCenterIDX].SetTraffic(serverID, traffic) != SM_SUCCESS) return M_FAILURE;
+    if (PartOf(dataCenterIDX, serverID)->SetTraffic(serverID, traffic) != SM_SUCCESS) return M_FAILURE;
+    if (window) {
+        window->traffics[epoch % windowEpochs] = epochTraffic;
+        window->total = traffic;
+    }
+
+    if (journal) journal->Append(J_SET_TRAFFIC, serverID, traffic);
+    Notify(-1);
+    Notify(dataCenterIDX);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::MoveServer(ServerID serverID, DataCenterID dataCenterID) {
+    if (engine) return M_FAILURE;   // the two data centers may be on different workers
+    if (serverID <= 0 || dataCenterID <= 0 || dataCenterID > dataCenterNum) return M_INVALID_INPUT;
+    if (journal && journal->Reserve(1) != J_SUCCESS) return M_FAILURE;
+    if (servers.GetDataCenterID(serverID) == 0) return M_FAILURE;  // server doesn't exist
+
+    int oldRoot = Move(serverID, dataCenterID), newRoot = ids.Find(dataCenterID);
+    if (journal) journal->Append(J_MOVE_SERVER, serverID, dataCenterID);
+    Notify(oldRoot);
+    if (newRoot != oldRoot) Notify(newRoot);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::MoveServers(int count, const ServerID* serverIDs, const DataCenterID* dataCenterIDs) {
+    if (engine) return M_FAILURE;
+    if (count < 0 || (count > 0 && (!serverIDs || !dataCenterIDs))) return M_INVALID_INPUT;
+    if (count > (INT_MAX - 1) / 4) return M_INVALID_INPUT;     // the roots below are counted in an int
+    for (int i = 0; i < count; i++) {
+        if (serverIDs[i] <= 0 || dataCenterIDs[i] <= 0 || dataCenterIDs[i] > dataCenterNum) return M_INVALID_INPUT;
+    }
+    for (int i = 0; i < count; i++) {
+        if (servers.GetDataCenterID(serverIDs[i]) == 0) return M_FAILURE;
+    }
+    if (journal && journal->Reserve(count) != J_SUCCESS) return M_FAILURE;     // the whole batch is journaled
+
+    // both roots of every move, to evaluate their subscriptions once each. moves don't change the union-find
+    auto roots = new int[4 * count + 1];
+    auto helper = roots + 2 * count;
+    int rootsNum = 0;
+    bool outOfMemory = false;
+    try {
+        for (int i = 0; i < count; i++) {
+            roots[rootsNum++] = Move(serverIDs[i], dataCenterIDs[i]);
+            roots[rootsNum++] = ids.Find(dataCenterIDs[i]);
+            if (journal) journal->Append(J_MOVE_SERVER, serverIDs[i], dataCenterIDs[i]);
+        }
+    } catch (std::bad_alloc& ba) {
+        // a move is all or nothing. the ones before it stay, and their data centers are evaluated like the rest
+        if (rootsNum % 2 == 1) rootsNum--;
+        outOfMemory = true;
+    }
 
+    try {
+        MergeSort(roots, helper, rootsNum);
+        for (int i = 0; i < rootsNum; i++) {
+            if (i == 0 || roots[i] != roots[i - 1]) Notify(roots[i]);
+        }
+    } catch (std::bad_alloc& ba) {
+        delete[] roots;
+        throw;
+    }
+    delete[] roots;
+    if (outOfMemory) throw std::bad_alloc();
+    return M_SUCCESS;
+}
+
+int DataCentersManager::Move(ServerID serverID, DataCenterID dataCenterID) {
+    int oldRoot = ids.Find(servers.GetDataCenterID(serverID)), newRoot = ids.Find(dataCenterID);
+    DataCenter* source = PartOf(oldRoot, serverID);
+    if (newRoot == oldRoot) {
+        // the same data center: its part keeps the server's node, only the data center's ID changes
+        source->MoveServer(serverID, dataCenterID, *source);
+    } else {
+        DataCenter*& destination = dataCenters[newRoot];
+        if (!destination) {
+            destination = new DataCenter(rankTree);
+            destination->KeepTopPrefix(topPrefix);
+            destination->BufferWrites(writeBuffer);
+        }
+        source->MoveServer(serverID, dataCenterID, *destination);
+    }
+
+    // the main ServersManager keeps the server where it is, its key doesn't change
+    servers.MoveServer(serverID, dataCenterID, servers);
+    return oldRoot;
+}
+
+void DataCentersManager::AddToEpoch(int slot, ServerID serverID) {
+    EpochServers& epochList = epochServers[slot];
+    if (epochList.count == epochList.capacity) {
+        int newCapacity = epochList.capacity ? 2 * epochList.capacity : 16;
+        auto newIDs = new ServerID[newCapacity];
+        for (int i = 0; i < epochList.count; i++) newIDs[i] = epochList.serverIDs[i];
+        delete[] epochList.serverIDs;
+        epochList.serverIDs = newIDs;
+        epochList.capacity = newCapacity;
+    }
+    epochList.serverIDs[epochList.count++] = serverID;
+}
+
+// a server whose window total drops when the oldest epoch leaves, by its data center's root
+struct WindowChange {
+    int root;
+    ServerID serverID;
+    int total;
+
+    bool operator<(const WindowChange& other) const {
+        return root < other.root || (root == other.root && serverID < other.serverID);
+    }
+};
+
+ManagerResult DataCentersManager::AdvanceEpoch() {
+    if (engine || windowEpochs == 0) return M_FAILURE;
+
+    // the slot of the next epoch holds the oldest one, only its servers with traffic change
+    int slot = (epoch + 1) % windowEpochs;
+    EpochServers& expired = epochServers[slot];
+    WindowChange* changes = nullptr, * helper = nullptr;
+    ServerID* serverIDs = nullptr;
+    int* totals = nullptr;
+    try {
+        changes = new WindowChange[expired.count];
+        helper = new WindowChange[expired.count];
+        serverIDs = new ServerID[expired.count];
+        totals = new int[expired.count];
+    } catch (std::bad_alloc& ba) {
+        delete[] changes;
+        delete[] helper;
+        delete[] serverIDs;
+        throw;
+    }
+
+    int changesNum = 0;
+    for (int i = 0; i < expired.count; i++) {
+        ServerID serverID = expired.serverIDs[i];
+        if (!windows.Contains(serverID)) continue;     // removed since
+        const TrafficWindow& window = windows.Find(serverID);
+        if (window.traffics[slot] == 0) continue;
+        changes[changesNum].root = ids.Find(servers.GetDataCenterID(serverID));
+        changes[changesNum].serverID = serverID;
+        changes[changesNum++].total = window.total - window.traffics[slot];
+    }
+
+    // sorted by data center, a server listed twice is adjacent to itself
+    MergeSort(changes, helper, changesNum);
+    int distinct = 0;
+    for (int i = 0; i < changesNum; i++) {
+        if (distinct > 0 && changes[i].serverID == serverIDs[distinct - 1]) continue;
+        changes[distinct] = changes[i];
+        serverIDs[distinct] = changes[i].serverID;
+        totals[distinct++] = changes[i].total;
+    }
+
+    // every rank tree takes all its changes at once
+    auto apply = [&]() {
+        servers.SetTraffics(serverIDs, totals, distinct);
+        for (int first = 0, last; first < distinct; first = last) {
+            int root = changes[first].root;
+            for (last = first + 1; last < distinct && changes[last].root == root; last++) {}
+            if (parts.Get(root).next == -1) {
+                dataCenters.Get(root)->SetTraffics(serverIDs + first, totals + first, last - first);
+            } else {
+                for (int i = first; i < last; i++) PartOf(root, serverIDs[i])->SetTraffic(serverIDs[i], totals[i]);
+            }
+        }
+    };
+    try {
+        apply();
+    } catch (std::bad_alloc& ba) {
+        // the epoch doesn't advance, so the rank trees go back to the totals in the window. setting a traffic again
+        // is harmless, so every data center is given its old ones, whether or not it took the new ones
+        for (int i = 0; i < distinct; i++) totals[i] = windows.Find(serverIDs[i]).total;
+        try {
+            apply();
+        } catch (std::bad_alloc& again) {
+            // nothing left to undo with
+        }
+        delete[] changes;
+        delete[] helper;
+        delete[] serverIDs;
+        delete[] totals;
+        throw;
+    }
+
+    for (int i = 0; i < distinct; i++) {
+        TrafficWindow& window = windows.Find(serverIDs[i]);
+        window.total = totals[i];
+        window.traffics[slot] = 0;
+    }
+    expired.count = 0;
+    epoch++;
+
+    Notify(-1);
+    for (int i = 0; i < distinct; i++) {
+        if (i == 0 || changes[i].root != changes[i - 1].root) Notify(changes[i].root);
+    }
+    delete[] changes;
+    delete[] helper;
+    delete[] serverIDs;
+    delete[] totals;
     return M_SUCCESS;
 }
 
 ManagerResult DataCentersManager::SumHighestTrafficServers(DataCenterID dataCenterID, int k, int* traffic) {
+    if (engine) return (ManagerResult)engine->SumHighestTrafficServers(dataCenterID, k, traffic);
     if (dataCenterID < 0 || dataCenterID > dataCenterNum || k < 0 || !traffic) return M_INVALID_INPUT;
 
-    if (dataCenterID == 0) { // in that case we need to get the sum from the main ServerManager
-        *traffic = servers.SumHighestTrafficServers(k);
+    // in case of 0 we need to get the sum from the main ServerManager
+    SumHighestTraffic(dataCenterID == 0 ? -1 : ids.Find(dataCenterID), &k, 1, traffic);
+    return M_SUCCESS;
+}
+
+// a query of a batch, by its data center's root
+struct BatchQuery {
+    int root, k, index;
+
+    bool operator<(const BatchQuery& other) const {
+        return root < other.root || (root == other.root && k < other.k);
+    }
+};
+
+ManagerResult DataCentersManager::SumHighestTrafficServers(int queriesNum, const DataCenterID* dataCenterIDs,
+                                                           const int* ks, int* traffics) {
+    if (queriesNum < 0) return M_INVALID_INPUT;
+    if (queriesNum == 0) return M_SUCCESS;
+    if (!dataCenterIDs || !ks || !traffics) return M_INVALID_INPUT;
+    int centersNum = engine ? engine->DataCentersNum() : dataCenterNum;
+    for (int i = 0; i < queriesNum; i++) {
+        if (dataCenterIDs[i] < 0 || dataCenterIDs[i] > centersNum || ks[i] < 0) return M_INVALID_INPUT;
+    }
+    if (engine) {
+        // every query goes to the worker that owns its data center
+        for (int i = 0; i < queriesNum; i++) {
+            ManagerResult result = (ManagerResult)engine->SumHighestTrafficServers(dataCenterIDs[i], ks[i], &traffics[i]);
+            if (result != M_SUCCESS) return result;
+        }
+        return M_SUCCESS;
+    }
+
+    // group the queries by root (one Find per query), with their ks ascending
+    auto queries = new BatchQuery[queriesNum];
+    BatchQuery* helper = nullptr;
+    int* groupKs = nullptr;
+    int* groupSums = nullptr;
+    try {
+        helper = new BatchQuery[queriesNum];
+        groupKs = new int[queriesNum];
+        groupSums = new int[queriesNum];
+    } catch (std::bad_alloc& ba) {
+        delete[] queries;
+        delete[] helper;
+        delete[] groupKs;
+        throw;
+    }
+    for (int i = 0; i < queriesNum; i++) {
+        queries[i].root = dataCenterIDs[i] == 0 ? -1 : ids.Find(dataCenterIDs[i]);
+        queries[i].k = ks[i];
+        queries[i].index = i;
+    }
+    MergeSort(queries, helper, queriesNum);
+
+    // every data center is descended once for all its ks
+    for (int first = 0, last; first < queriesNum; first = last) {
+        for (last = first; last < queriesNum && queries[last].root == queries[first].root; last++) {
+            groupKs[last - first] = queries[last].k;
+        }
+        if (last < queriesNum && queries[last].root != -1) __builtin_prefetch(dataCenters.Get(queries[last].root));
+
+        SumHighestTraffic(queries[first].root, groupKs, last - first, groupSums);
+        for (int i = first; i < last; i++) traffics[queries[i].index] = groupSums[i - first];
+    }
+
+    delete[] queries;
+    delete[] helper;
+    delete[] groupKs;
+    delete[] groupSums;
+    return M_SUCCESS;
+}
+
+void DataCentersManager::SumHighestTraffic(int root, const int* ks, int count, int* sums) {
+    Flush(root);
+    if (root == -1) {
+        servers.SumHighestTrafficServers(ks, count, sums);
+        return;
+    }
+
+    if (parts.Get(root).next == -1) {
+        DataCenter* dataCenter = dataCenters.Get(root);
+        if (dataCenter) {
+            dataCenter->SumHighestTrafficServers(ks, count, sums);
+        } else {
+            for (int i = 0; i < count; i++) sums[i] = 0;   // no servers yet
+        }
+        return;
+    }
+
+    // a lazily merged data center: the top k of all its parts at once
+    int partsNum = 0;
+    auto centers = new DataCenter*[parts.Get(root).count];
+    for (int i = root; i != -1; i = parts.Get(i).next) {
+        if (dataCenters.Get(i)) centers[partsNum++] = dataCenters.Get(i);
+    }
+    for (int i = 0; i < count; i++) sums[i] = ServersManager::SumHighestTrafficServers(centers, partsNum, ks[i]);
+    delete[] centers;
+}
+
+ManagerResult DataCentersManager::FleetReport(int k, int maxCount, DataCenterID* dataCenterIDs, int* serversNums,
+                                             int* trafficSums, int* highestSums, int* count) {
+    if (engine) return M_FAILURE;   // the data centers are spread across the workers
+    if (k < 0 || maxCount < 0 || !count) return M_INVALID_INPUT;
+    if (maxCount > 0 && (!dataCenterIDs || !serversNums || !trafficSums || !highestSums)) return M_INVALID_INPUT;
+
+    // one pass over the union-find for the roots. lazily merged ones are merged for real, so each has one manager
+    int rootsNum = 0;
+    for (int i = 0; i < dataCenterNum; i++) {
+        if (!ids.IsRoot(i)) continue;
+        if (lazyMerge && parts.Get(i).next != -1 && !Consolidate(i)) return M_ALLOCATION_ERROR;
+        if (rootsNum < maxCount) dataCenterIDs[rootsNum] = i + 1;
+        rootsNum++;
+    }
+    *count = rootsNum;
+    if (rootsNum > maxCount) return M_FAILURE;  // not enough room
+
+    // every thread reports on its own slice of the roots. a manager is only touched by the thread of its root,
+    // which applies its buffered writes first
+    int threadsNum = rootsNum > PARALLEL_REPORT_THRESHOLD ? ParallelThreadsNum() : 1;
+    ParallelFor(threadsNum, [&](int t) {
+        int first = (int)((long long)rootsNum * t / threadsNum);
+        int last = (int)((long long)rootsNum * (t + 1) / threadsNum);
+        for (int i = first; i < last; i++) {
+            DataCenter* dataCenter = dataCenters.Get(dataCenterIDs[i] - 1);
+            if (i + 1 < last) __builtin_prefetch(dataCenters.Get(dataCenterIDs[i + 1] - 1));
+            if (!dataCenter) {
+                serversNums[i] = trafficSums[i] = highestSums[i] = 0;  // no servers yet
+                continue;
+            }
+
+            dataCenter->Flush();
+            int trafficServersNum;
+            serversNums[i] = dataCenter->ServersNum();
+            dataCenter->TrafficAtLeast(1, &trafficServersNum, &trafficSums[i]);
+            highestSums[i] = dataCenter->SumHighestTrafficServers(k);
+        }
+    });
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::AddDataCenter(DataCenterID* dataCenterID) {
+    if (engine) return (ManagerResult)engine->AddDataCenter(dataCenterID);
+    if (!dataCenterID) return M_INVALID_INPUT;
+    if (dataCenterNum == MAX_DATA_CENTERS) return M_FAILURE;
+    if (journal && journal->Reserve(1) != J_SUCCESS) return M_FAILURE;
+
+    // the union-find and the slots grow in chunks, nothing that exists moves
+    dataCenters.Grow(dataCenterNum + 1);
+    parts.Grow(dataCenterNum + 1);
+    subscribers.Grow(dataCenterNum + 1);
+    ids.Grow(dataCenterNum + 1);
+    *dataCenterID = ++dataCenterNum;
+
+    if (journal) journal->Append(J_ADD_DATA_CENTER, *dataCenterID, 0);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::FreezeDataCenter(DataCenterID dataCenterID) {
+    if (engine) return (ManagerResult)engine->FreezeDataCenter(dataCenterID);
+    if (dataCenterID < 0 || dataCenterID > dataCenterNum) return M_INVALID_INPUT;
+
+    if (dataCenterID == 0) {
+        servers.Freeze();
+        return M_SUCCESS;
+    }
+
+    // a lazily merged data center is merged for real first, so there is one array to query
+    int root = ids.Find(dataCenterID);
+    if (parts.Get(root).next != -1 && !Consolidate(root)) return M_ALLOCATION_ERROR;
+    DataCenter* dataCenter = dataCenters.Get(root);
+    if (dataCenter) dataCenter->Freeze();
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::KeepTopPrefix(int limit) {
+    if (engine) return M_FAILURE;   // the data centers are spread across the workers
+    if (limit < 0 || limit > TOP_PREFIX_MAX) return M_INVALID_INPUT;
+
+    // if memory runs out on the way, the managers that were done keep the new limit
+    servers.KeepTopPrefix(limit);
+    dataCenters.ForEach([limit](int, DataCenter* center) { if (center) center->KeepTopPrefix(limit); });
+    topPrefix = limit;
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::BufferWrites(int capacity) {
+    if (engine) return M_FAILURE;   // the data centers are spread across the workers
+    if (capacity < 0 || capacity > WRITE_BUFFER_MAX) return M_INVALID_INPUT;
+
+    // every buffer is flushed before it changes
+    servers.BufferWrites(capacity);
+    dataCenters.ForEach([capacity](int, DataCenter* center) { if (center) center->BufferWrites(capacity); });
+    writeBuffer = capacity;
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::Subscribe(DataCenterID dataCenterID, int k, int threshold,
+                                           TrafficAlertCallback callback, void* context, int* subscriptionID) {
+    if (engine) return M_FAILURE;   // the data centers are spread across the workers
+    if (dataCenterID < 0 || dataCenterID > dataCenterNum || k < 0 || !callback || !subscriptionID) return M_INVALID_INPUT;
+
+    // a free slot, or a new one. get every cell (and the current sum) before changing any, allocating may fail
+    int root = (dataCenterID == 0) ? -1 : ids.Find(dataCenterID);
+    int index = freeSubscriptions;
+    if (index == -1) {
+        index = subscriptionsNum;
+        subscriptions.Grow(index + 1);
+    }
+    Subscription& subscription = subscriptions[index];
+    int& first = (root == -1) ? globalSubscribers : subscribers[root];
+    int sum;
+    SumHighestTraffic(root, &k, 1, &sum);
+
+    if (index == freeSubscriptions) freeSubscriptions = subscription.next;
+    else subscriptionsNum++;
+    subscription.dataCenterID = dataCenterID;
+    subscription.k = k;
+    subscription.threshold = threshold;
+    subscription.above = (sum >= threshold);
+    subscription.callback = callback;
+    subscription.context = context;
+
+    // first in the root's list
+    subscription.prev = -1;
+    subscription.next = first;
+    if (first != -1) subscriptions[first].prev = index;
+    first = index;
+
+    *subscriptionID = index + 1;
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::Unsubscribe(int subscriptionID) {
+    if (engine) return M_FAILURE;
+    if (subscriptionID <= 0 || subscriptionID > subscriptionsNum) return M_INVALID_INPUT;
+    int index = subscriptionID - 1;
+    Subscription& subscription = subscriptions[index];     // was written, doesn't allocate
+    if (!subscription.callback) return M_FAILURE;   // not subscribed
+
+    // out of its root's list, into the free list
+    if (subscription.prev != -1) {
+        subscriptions[subscription.prev].next = subscription.next;
+    } else if (subscription.dataCenterID == 0) {
+        globalSubscribers = subscription.next;
     } else {
-        int dataCenterIDX = ids.Find(dataCenterID);
-        *traffic = dataCenters[dataCenterIDX].SumHighestTrafficServers(k);
+        subscribers[ids.Find(subscription.dataCenterID)] = subscription.next;
+    }
+    if (subscription.next != -1) subscriptions[subscription.next].prev = subscription.prev;
+
+    subscription.callback = nullptr;
+    subscription.context = nullptr;
+    subscription.next = freeSubscriptions;
+    freeSubscriptions = index;
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::TrafficByRank(DataCenterID dataCenterID, int rank, int* traffic) {
+    if (rank <= 0 || !traffic) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    if (!scope || rank > scope->ServersNum()) return M_FAILURE;  // not that many servers
+    *traffic = scope->TrafficByRank(rank);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::RankOfTraffic(DataCenterID dataCenterID, int traffic, int* rank) {
+    if (traffic < 0 || !rank) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    // the servers above it come first
+    int sum;
+    *rank = 1 + (scope ? scope->CountAbove(traffic, &sum) : 0);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::CountTrafficAbove(DataCenterID dataCenterID, int traffic, int* count, int* sum) {
+    if (traffic < 0 || !count || !sum) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    *count = *sum = 0;
+    if (scope) *count = scope->CountAbove(traffic, sum);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::CountTrafficBelow(DataCenterID dataCenterID, int traffic, int* count, int* sum) {
+    if (traffic < 0 || !count || !sum) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    *count = *sum = 0;
+    if (scope) *count = scope->CountBelow(traffic, sum);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::TrafficPercentile(DataCenterID dataCenterID, int percentile, int* traffic) {
+    if (percentile < 0 || percentile > 100 || !traffic) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    if (!scope || scope->ServersNum() == 0) return M_FAILURE;  // no servers
+    *traffic = scope->Percentile(percentile);
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::HighestTrafficServers(DataCenterID dataCenterID, int k, ServerID* serverIDs,
+                                                        int* traffics, int* count) {
+    if (k < 0 || !serverIDs || !traffics || !count) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    *count = scope ? scope->ListHighest(k, serverIDs, traffics) : 0;
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::TrafficRangeServers(DataCenterID dataCenterID, int low, int high, int maxCount,
+                                                      ServerID* serverIDs, int* traffics, int* count) {
+    if (low < 0 || high < low || maxCount < 0 || !serverIDs || !traffics || !count) return M_INVALID_INPUT;
+    DataCenter* scope;
+    ManagerResult result = Scope(dataCenterID, &scope);
+    if (result != M_SUCCESS) return result;
+
+    *count = scope ? scope->ListRange(low, high, maxCount, serverIDs, traffics) : 0;
+    return M_SUCCESS;
+}
+
+DataCentersManager* DataCentersManager::CreatePartitioned(int size, int workersNum) {
+    auto engine = new PartitionedEngine(size, workersNum);
+    try {
+        return new DataCentersManager(size, engine);
+    } catch (std::bad_alloc& ba) {
+        delete engine;
+        throw;
+    }
+}
+
+DataCentersManager* DataCentersManager::Recover(int size, const char* snapshotPath, const char* journalPath) {
+    // load the last snapshot (or start empty if there is none)
+    int generation = 0;
+    DataCentersManager* manager = LoadSnapshot(size, snapshotPath, &generation);
+    if (!manager) return nullptr;   // corrupted snapshot
+
+    // replay the journal tail, only if it was written on top of this snapshot
+    {
+        Journal::Reader reader(journalPath);
+        if (reader.IsOpen() && reader.Generation() == generation) {
+            JournalRecord record;
+            while (reader.Next(&record)) manager->ApplyRecord(record);
+        }
+    }
+
+    // keep appending to the same journal
+    auto journal = new Journal(journalPath, snapshotPath);
+    if (journal->Open(generation) != J_SUCCESS) {
+        delete journal;
+        delete manager;
+        return nullptr;
+    }
+    manager->journal = journal;
+
+    return manager;
+}
+
+ManagerResult DataCentersManager::Checkpoint() {
+    if (!journal) return M_FAILURE;
+
+    // the snapshot covers everything journaled so far, so the journal restarts with the next generation
+    int generation = journal->Generation() + 1;
+    if (SaveSnapshot(journal->SnapshotPath(), generation) != M_SUCCESS) return M_FAILURE;
+    if (journal->Restart(generation) != J_SUCCESS) return M_FAILURE;
+
+    return M_SUCCESS;
+}
+
+ManagerResult DataCentersManager::CommitJournal() {
+    if (!journal) return M_FAILURE;
+    return (journal->Commit() == J_SUCCESS) ? M_SUCCESS : M_FAILURE;
+}
+
+ManagerResult DataCentersManager::PublishSharedState(const char* name) {
+    if (engine) return M_FAILURE;   // the state is spread across the workers
+    if (servers.IsApproximate()) return M_FAILURE;  // there is no tree of all the servers to publish
+    if (!shared) {
+        shared = SharedState::Create(name);
+        if (!shared) return M_FAILURE;
+    }
+
+    // every data center is published from one tree
+    for (int i = 0; i < dataCenterNum; i++) {
+        if (parts.Get(i).next != -1 && ids.Find(i + 1) == i && !Consolidate(i)) return M_ALLOCATION_ERROR;
+    }
+
+    // every server with traffic is in the main tree and in exactly one data center's tree
+    servers.Flush();
+    for (int i = 0; i < dataCenterNum; i++) {
+        if (ids.IsRoot(i)) Flush(i);
+    }
+    int serversNum = servers.TrafficServersNum();
+    auto sorted = new ServerKey[serversNum];  // before the publish begins, it must end
+    if (shared->BeginPublish(dataCenterNum, 2 * serversNum) != SS_SUCCESS) {
+        delete[] sorted;
+        return M_FAILURE;
+    }
+
+    int count = 0;
+    auto collect = [&](const ServerKey& key) { sorted[count++] = key; };
+
+    // the union-find, flattened: every data center points straight at its root, and every root has its tree
+    for (int i = 0; i < dataCenterNum; i++) {
+        int root = ids.Find(i + 1);
+        shared->SetRoot(i, root);
+        if (root != i) continue;
+
+        count = 0;
+        DataCenter* dataCenter = dataCenters.Get(i);
+        if (dataCenter) dataCenter->ForEachByTraffic(collect);
+        shared->SetTree(i, shared->BuildTree(sorted, count));
+    }
+
+    count = 0;
+    servers.ForEachByTraffic(collect);
+    shared->SetGlobalTree(shared->BuildTree(sorted, count));
+
+    delete[] sorted;
+    shared->EndPublish();
+
+    return M_SUCCESS;
+}
+
+//-------------------------PRIVATE FUNCTIONS-------------------------
+
+void DataCentersManager::Notify(int root) {
+    int first = (root == -1) ? globalSubscribers : subscribers.Get(root);
+    for (int i = first, next; i != -1; i = next) {
+        Subscription& subscription = subscriptions[i];     // was written, doesn't allocate
+        next = subscription.next;
+        int sum;
+        try {
+            SumHighestTraffic(root, &subscription.k, 1, &sum);
+        } catch (std::bad_alloc& ba) {
+            continue;   // the change is done. this one is evaluated again with the next change
+        }
+
+        bool above = (sum >= subscription.threshold);
+        if (above == subscription.above) continue;
+        subscription.above = above;
+        subscription.callback(subscription.context, i + 1, sum, above);
+    }
+}
+
+void DataCentersManager::UniteSubscribers(int root1, int root2, int newRoot) {
+    int first1 = subscribers.Get(root1), first2 = subscribers.Get(root2);
+    if (first1 == -1 && first2 == -1) return;
+
+    // root1's list, then root2's
+    int first = first1;
+    if (first1 == -1) {
+        first = first2;
+    } else if (first2 != -1) {
+        int last = first1;
+        while (subscriptions.Get(last).next != -1) last = subscriptions.Get(last).next;
+        subscriptions[last].next = first2;
+        subscriptions[first2].prev = last;
+    }
+    subscribers[root1] = subscribers[root2] = -1;
+    subscribers[newRoot] = first;
+}
+
+int DataCentersManager::LinkParts(int root1, int root2) {
+    // get every cell before changing any, allocating them may fail
+    DataCenterParts& parts1 = parts[root1], & parts2 = parts[root2];
+    DataCenterParts& last1 = parts[parts1.last == -1 ? root1 : parts1.last];
+    DataCenterParts& last2 = parts[parts2.last == -1 ? root2 : parts2.last];
+    int newRoot = ids.Union(root1, root2);
+
+    // the new root's list goes first, then the other root's list
+    bool firstIs1 = (newRoot == root1);
+    DataCenterParts& first = firstIs1 ? parts1 : parts2, & second = firstIs1 ? parts2 : parts1;
+    int secondRoot = firstIs1 ? root2 : root1;
+    (firstIs1 ? last1 : last2).next = secondRoot;
+    first.last = (second.last == -1) ? secondRoot : second.last;
+    first.count += second.count;
+    return newRoot;
+}
+
+bool DataCentersManager::Consolidate(int root) {
+    int count = parts.Get(root).count, num = 0;
+    DataCenter** level = nullptr;
+    bool* owned = nullptr;  // the data centers merged here, the others are still in their slots
+    int merged = 0, next = 0;
+    try {
+        dataCenters[root];  // the root's slot must exist before anything changes
+        level = new DataCenter*[count];
+        owned = new bool[count]();
+        for (int i = root; i != -1; i = parts.Get(i).next) {
+            if (dataCenters.Get(i)) level[num++] = dataCenters.Get(i);
+        }
+        for (int i = 0; i < num; i++) level[i]->Flush();
+
+        // merge in pairs, so every server is copied log(parts) times
+        while (num > 1) {
+            for (next = 0, merged = 0; merged < num; merged += 2) {
+                if (merged + 1 == num) {
+                    level[next] = level[merged];
+                    owned[next++] = owned[merged];
+                    continue;
+                }
+                auto center = new DataCenter(ServersManager::MergeServers(*level[merged], *level[merged + 1]));
+                if (owned[merged]) delete level[merged];
+                if (owned[merged + 1]) delete level[merged + 1];
+                level[next] = center;
+                owned[next++] = true;
+            }
+            num = next;
+            next = 0;
+        }
+    } catch (std::bad_alloc& ba) {
+        // the merged ones of this level are before next, the ones not merged yet from merged on
+        for (int i = 0; level && i < next; i++) if (owned[i]) delete level[i];
+        for (int i = merged; level && owned && i < num; i++) if (owned[i]) delete level[i];
+        delete[] owned;
+        delete[] level;
+        return false;
+    }
+
+    // release the parts and unlink them, the result goes to the root's slot
+    DataCenter* result = (num == 1) ? level[0] : nullptr;
+    for (int i = root, nextPart; i != -1; i = nextPart) {
+        nextPart = parts.Get(i).next;
+        DataCenter* part = dataCenters.Get(i);
+        if (part) {
+            if (part != result) delete part;
+            dataCenters[i] = nullptr;
+        }
+        if (i != root) parts[i].next = -1;
+    }
+    parts[root] = DataCenterParts();
+    dataCenters[root] = result;
+
+    delete[] owned;
+    delete[] level;
+    return true;
+}
+
+ManagerResult DataCentersManager::Scope(DataCenterID dataCenterID, DataCenter** scope) {
+    if (engine) return M_FAILURE;   // the servers are spread across the workers
+    if (dataCenterID < 0 || dataCenterID > dataCenterNum) return M_INVALID_INPUT;
+
+    if (dataCenterID == 0) {
+        if (servers.IsApproximate()) return M_FAILURE;  // no keys to order
+        servers.Flush();
+        *scope = &servers;
+        return M_SUCCESS;
     }
 
+    // a lazily merged data center is merged for real first, the order statistics are on one tree
+    int root = ids.Find(dataCenterID);
+    if (parts.Get(root).next != -1 && !Consolidate(root)) return M_ALLOCATION_ERROR;
+    Flush(root);
+    *scope = dataCenters.Get(root);
     return M_SUCCESS;
 }
+
+void DataCentersManager::Flush(int root) {
+    if (root == -1) {
+        servers.Flush();
+        return;
+    }
+    for (int i = root; i != -1; i = parts.Get(i).next) {
+        DataCenter* part = dataCenters.Get(i);
+        if (part) part->Flush();
+    }
+}
+
+DataCenter* DataCentersManager::PartOf(int root, ServerID serverID) {
+    if (parts.Get(root).next == -1) return dataCenters.Get(root);
+
+    // a lazily merged data center: the part that has the server
+    for (int i = root; i != -1; i = parts.Get(i).next) {
+        DataCenter* part = dataCenters.Get(i);
+        if (part && part->GetDataCenterID(serverID) != 0) return part;
+    }
+    return nullptr;
+}
+
+ManagerResult DataCentersManager::SaveSnapshot(const char* path, int generation) {
+    servers.Flush();    // the servers' traffics are written from their entries
+
+    // write to a temporary file first, so a crash never leaves a half written snapshot
+    auto tmpPath = new char[strlen(path) + 5];
+    strcpy(tmpPath, path);
+    strcat(tmpPath, ".tmp");
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        delete[] tmpPath;
+        return M_FAILURE;
+    }
+
+    // count the servers
+    int serverCount = 0;
+    servers.ForEachServer([&](const Server&) { serverCount++; });
+
+    // header: magic, generation, number of data centers, number of servers
+    int header[4] = {SNAPSHOT_MAGIC, generation, dataCenterNum, serverCount};
+    bool ok = Journal::WriteAll(fd, header, sizeof(header));
+
+    // the union-find: the root data center of every data center
+    auto buffer = new int[3 * SNAPSHOT_CHUNK_SIZE];
+    for (int first = 1; ok && first <= dataCenterNum; first += SNAPSHOT_CHUNK_SIZE) {
+        int count = 0;
+        for (int i = first; i <= dataCenterNum && count < SNAPSHOT_CHUNK_SIZE; i++, count++) {
+            buffer[count] = ids.Find(i) + 1;
+        }
+        ok = Journal::WriteAll(fd, buffer, count * (long)sizeof(int));
+    }
+
+    // the servers: id, data center id and traffic
+    int count = 0;
+    servers.ForEachServer([&](const Server& server) {
+        buffer[3 * count] = server.serverID;
+        buffer[3 * count + 1] = server.dataCenterID;
+        buffer[3 * count + 2] = server.traffic;
+        if (++count == SNAPSHOT_CHUNK_SIZE) {
+            ok = ok && Journal::WriteAll(fd, buffer, 3 * count * (long)sizeof(int));
+            count = 0;
+        }
+    });
+    ok = ok && Journal::WriteAll(fd, buffer, 3 * count * (long)sizeof(int));
+    delete[] buffer;
+
+    ok = (fsync(fd) == 0) && ok;
+    close(fd);
+
+    // atomically replace the old snapshot
+    ok = ok && (rename(tmpPath, path) == 0);
+    delete[] tmpPath;
+
+    return ok ? M_SUCCESS : M_FAILURE;
+}
+
+DataCentersManager* DataCentersManager::LoadSnapshot(int size, const char* path, int* generation) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) { // no snapshot yet
+        *generation = 0;
+        return new DataCentersManager(size);
+    }
+
+    int header[4];
+    if (Journal::ReadAll(fd, header, sizeof(header)) != sizeof(header) || header[0] != SNAPSHOT_MAGIC) {
+        close(fd);
+        return nullptr;
+    }
+    *generation = header[1];
+    int dataCenterNum = header[2], serverCount = header[3];
+
+    // the snapshot decides the number of data centers
+    auto manager = new DataCentersManager(dataCenterNum);
+    auto buffer = new int[3 * SNAPSHOT_CHUNK_SIZE];
+    bool ok = true;
+
+    // rebuild the union-find. the data centers are still empty, so merging them is cheap
+    for (int first = 1; ok && first <= dataCenterNum; first += SNAPSHOT_CHUNK_SIZE) {
+        int count = (dataCenterNum - first + 1 < SNAPSHOT_CHUNK_SIZE) ? dataCenterNum - first + 1 : SNAPSHOT_CHUNK_SIZE;
+        ok = Journal::ReadAll(fd, buffer, count * (long)sizeof(int)) == count * (long)sizeof(int);
+        for (int i = 0; ok && i < count; i++) {
+            if (buffer[i] != first + i) manager->MergeDataCenters(first + i, buffer[i]);
+        }
+    }
+
+    // add the servers with their traffic
+    for (int loaded = 0; ok && loaded < serverCount; ) {
+        int count = (serverCount - loaded < SNAPSHOT_CHUNK_SIZE) ? serverCount - loaded : SNAPSHOT_CHUNK_SIZE;
+        ok = Journal::ReadAll(fd, buffer, 3 * count * (long)sizeof(int)) == 3 * count * (long)sizeof(int);
+        for (int i = 0; ok && i < count; i++) {
+            manager->AddServer(buffer[3 * i + 1], buffer[3 * i]);
+            if (buffer[3 * i + 2] != 0) manager->SetTraffic(buffer[3 * i], buffer[3 * i + 2]);
+        }
+        loaded += count;
+    }
+
+    delete[] buffer;
+    close(fd);
+
+    if (!ok) {
+        delete manager;
+        return nullptr;
+    }
+    return manager;
+}
+
+void DataCentersManager::ApplyRecord(const JournalRecord& record) {
+    // the journal only holds successful mutations, so replaying them in order rebuilds the same state
+    switch (record.op) {
+        case J_ADD_SERVER:
+            AddServer(record.arg1, record.arg2);
+            break;
+        case J_REMOVE_SERVER:
+            RemoveServer(record.arg1);
+            break;
+        case J_SET_TRAFFIC:
+            SetTraffic(record.arg1, record.arg2);
+            break;
+        case J_MERGE_DATA_CENTERS:
+            MergeDataCenters(record.arg1, record.arg2);
+            break;
+        case J_MOVE_SERVER:
+            MoveServer(record.arg1, record.arg2);
+            break;
+        case J_ADD_DATA_CENTER: {
+            DataCenterID dataCenterID;
+            AddDataCenter(&dataCenterID);
+            break;
+        }
+        default:
+            break;
+    }
+}
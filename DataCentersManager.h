@@ -2,6 +2,9 @@
 #define DATACENTERS_WET2_DATACENTERSMANAGER_H
 #include "UnionFind.h"
 #include "ServersManager.h"
+#include "Journal.h"
+#include "SharedState.h"
+#include "PartitionedEngine.h"
 
 enum ManagerResult {
     M_SUCCESS = 0,
@@ -12,26 +15,160 @@ enum ManagerResult {
 
 typedef ServersManager DataCenter;
 
+const int LAZY_MERGE_MAX_PARTS = 8; // a lazily merged data center with more parts is merged for real
+const int WINDOW_MAX_EPOCHS = 16;   // the longest traffic window, in epochs
+
+// called when a subscribed top-k sum crosses its threshold. above is 1 if it's now at least the threshold
+typedef void (*TrafficAlertCallback)(void* context, int subscriptionID, int sum, int above);
+
 class DataCentersManager {
 public:
-    explicit DataCentersManager(int size) :
-        servers(),
-        ids(size),
-        dataCenterNum(size),
-        dataCenters(new DataCenter[size]) {};
+    // approximate: the queries on all the servers are answered from a histogram instead of a rank tree.
+    // windowEpochs: if not 0, a server's traffic is the total of its last windowEpochs epochs (see AdvanceEpoch)
+    explicit DataCentersManager(int size, RankTreeEngine rankTree = RANK_TREE_AVL, bool lazyMerge = false,
+                                bool approximate = false, int windowEpochs = 0);
+
+    ~DataCentersManager();
+
+    // the data centers are partitioned across worker threads (see PartitionedEngine)
+    static DataCentersManager* CreatePartitioned(int size, int workersNum);
 
-    ~DataCentersManager() { delete[] dataCenters; };
     ManagerResult MergeDataCenters(DataCenterID dataCenter1, DataCenterID dataCenter2);
     ManagerResult AddServer(DataCenterID dataCenterID, ServerID serverID);
     ManagerResult RemoveServer(ServerID serverID);
     ManagerResult SetTraffic(ServerID serverID, int traffic);
+    // moves a server to another data center with its traffic. the ranking of all the servers doesn't change
+    ManagerResult MoveServer(ServerID serverID, DataCenterID dataCenterID);
+    // moves every serverIDs[i] to dataCenterIDs[i], in order. INVALID_INPUT or FAILURE (a server doesn't exist)
+    // before any of them moves. if it runs out of memory, the moves before that one stay
+    ManagerResult MoveServers(int count, const ServerID* serverIDs, const DataCenterID* dataCenterIDs);
     ManagerResult SumHighestTrafficServers(DataCenterID dataCenterID, int k, int* traffic);
+    // traffics[i] is the answer for (dataCenterIDs[i], ks[i]). the queries of each data center are answered together
+    ManagerResult SumHighestTrafficServers(int queriesNum, const DataCenterID* dataCenterIDs, const int* ks, int* traffics);
+    // for every merged data center (by its root's ID): its servers, their total traffic and the sum of its k highest.
+    // FAILURE if there are more than maxCount, count is set to the number there are either way
+    ManagerResult FleetReport(int k, int maxCount, DataCenterID* dataCenterIDs, int* serversNums, int* trafficSums,
+                              int* highestSums, int* count);
+    ManagerResult AddDataCenter(DataCenterID* dataCenterID);   // the new data center gets the next ID
+    ManagerResult FreezeDataCenter(DataCenterID dataCenterID);  // read optimized until its next change. 0 for all servers
+    ManagerResult KeepTopPrefix(int limit);     // see ServersManager::KeepTopPrefix, for every data center
+    // see ServersManager::BufferWrites, for every data center. a data center's buffer is flushed by its queries,
+    // and so by every change while it (or all the servers) has a subscription, see Notify
+    ManagerResult BufferWrites(int capacity);
+
+    // alerts on the sum of the k highest traffics of a data center (0 for all the servers), kept across its merges.
+    // it's evaluated again after every change of that data center, and the callback is called when it crosses
+    ManagerResult Subscribe(DataCenterID dataCenterID, int k, int threshold, TrafficAlertCallback callback,
+                            void* context, int* subscriptionID);
+    ManagerResult Unsubscribe(int subscriptionID);
+
+    // windowed traffic: SetTraffic sets the server's traffic of the current epoch, and the rank trees are ordered by
+    // the total of the window. AdvanceEpoch starts a new epoch and drops the oldest from the window; only the servers
+    // with traffic in that epoch change, and every rank tree takes its changes as one batch. FAILURE if not windowed
+    ManagerResult AdvanceEpoch();
+
+    // order statistics of a data center, or of all the servers if the ID is 0 (see ServersManager)
+    ManagerResult TrafficByRank(DataCenterID dataCenterID, int rank, int* traffic);
+    ManagerResult RankOfTraffic(DataCenterID dataCenterID, int traffic, int* rank);
+    ManagerResult CountTrafficAbove(DataCenterID dataCenterID, int traffic, int* count, int* sum);
+    ManagerResult CountTrafficBelow(DataCenterID dataCenterID, int traffic, int* count, int* sum);
+    ManagerResult TrafficPercentile(DataCenterID dataCenterID, int percentile, int* traffic);
+
+    // the servers with traffic in descending (traffic, id) order, written to the caller's arrays
+    ManagerResult HighestTrafficServers(DataCenterID dataCenterID, int k, ServerID* serverIDs, int* traffics, int* count);
+    ManagerResult TrafficRangeServers(DataCenterID dataCenterID, int low, int high, int maxCount,
+                                      ServerID* serverIDs, int* traffics, int* count);
+
+    // durability: load the last snapshot, replay the journal tail and keep journaling from there
+    static DataCentersManager* Recover(int size, const char* snapshotPath, const char* journalPath);
+    ManagerResult Checkpoint();
+    ManagerResult CommitJournal();
+
+    // copy the union-find and the rank trees into a shared-memory image other processes can query
+    ManagerResult PublishSharedState(const char* name);
 
 private:
+    // the parts of a lazily merged data center are the slots of its former roots, linked from the root
+    struct DataCenterParts {
+        DataCenterParts() : next(-1), last(-1), count(1) {}
+
+        int next;   // the next part's index, -1 at the end
+        int last;   // only at a root: its last part's index, -1 if the root is the only part
+        int count;  // only at a root: the number of parts
+    };
+
+    struct Subscription {
+        Subscription() : dataCenterID(0), k(0), threshold(0), above(false), callback(nullptr), context(nullptr),
+                         prev(-1), next(-1) {}
+
+        DataCenterID dataCenterID;  // the one subscribed to, its root may change
+        int k, threshold;
+        bool above;     // the sum was at least threshold when last evaluated
+        TrafficAlertCallback callback;  // nullptr if the slot is free
+        void* context;
+        int prev, next; // in the list of the data center's root, a free slot is in the free list by next
+    };
+
+    // a server's traffic in each epoch of the window, by epoch modulo the window
+    struct TrafficWindow {
+        TrafficWindow() : traffics(), total(0) {}
+
+        int traffics[WINDOW_MAX_EPOCHS];
+        int total;      // the traffic in the rank trees
+    };
+
+    // the servers that got traffic in an epoch of the window. a server may be listed more than once, or no longer
+    // exist; the ones whose traffic in the epoch is 0 are skipped
+    struct EpochServers {
+        EpochServers() : serverIDs(nullptr), count(0), capacity(0) {}
+
+        ServerID* serverIDs;
+        int count, capacity;
+    };
+
     ServersManager servers;
     UnionFind ids;
     int dataCenterNum;
-    DataCenter* dataCenters;
+    RankTreeEngine rankTree;
+    ChunkedArray<DataCenter*> dataCenters;  // by root index. nullptr until the data center has a server
+    bool lazyMerge;     // merges link the data centers' parts instead of merging them
+    ChunkedArray<DataCenterParts> parts;    // by index, only used if lazyMerge
+    Journal* journal;   // nullptr if journaling is off
+    SharedState* shared;    // nullptr if never published
+    PartitionedEngine* engine;  // if not nullptr, every operation is forwarded to it
+    int topPrefix;      // how many highest keys every manager keeps apart, 0 if none
+    int writeBuffer;    // the capacity of every manager's write buffer, 0 if the writes aren't buffered
+    ChunkedArray<Subscription> subscriptions;   // by ID - 1
+    int subscriptionsNum;   // the slots used so far
+    int freeSubscriptions;  // the first free slot, -1 if none
+    ChunkedArray<int> subscribers;  // by root index: its first subscription, -1 if none
+    int globalSubscribers;  // the first subscription to all the servers, -1 if none
+    int windowEpochs;   // 0 if traffic isn't windowed
+    int epoch;          // the current epoch, its traffics are in slot epoch % windowEpochs
+    HashTable<TrafficWindow> windows;   // by server ID, only if windowed
+    EpochServers epochServers[WINDOW_MAX_EPOCHS];
+
+    DataCentersManager(int size, PartitionedEngine* engine) :
+        servers(), ids(0), dataCenterNum(size), rankTree(RANK_TREE_AVL), dataCenters(0, nullptr),
+        lazyMerge(false), parts(0), journal(nullptr), shared(nullptr), engine(engine), topPrefix(0), writeBuffer(0),
+        subscriptions(0),
+        subscriptionsNum(0), freeSubscriptions(-1), subscribers(0, -1), globalSubscribers(-1), windowEpochs(0),
+        epoch(0), windows(), epochServers() {};
+
+    ManagerResult SaveSnapshot(const char* path, int generation);
+    static DataCentersManager* LoadSnapshot(int size, const char* path, int* generation);
+    void ApplyRecord(const JournalRecord& record);
+    int LinkParts(int root1, int root2);    // unites the roots and returns the new one
+    bool Consolidate(int root);     // merges the parts into one. false if there isn't enough memory
+    DataCenter* PartOf(int root, ServerID serverID);
+    void Flush(int root);   // applies the buffered writes of a data center's parts. root -1 for all servers
+    int Move(ServerID serverID, DataCenterID dataCenterID);    // an existing server. returns its old root
+    void SumHighestTraffic(int root, const int* ks, int count, int* sums);    // ks ascending. root -1 for all servers
+    // evaluates the subscriptions of a data center that changed, which applies its buffered writes. root -1 for all servers
+    void Notify(int root);
+    void UniteSubscribers(int root1, int root2, int newRoot);  // both roots' cells exist if either has subscribers
+    void AddToEpoch(int slot, ServerID serverID);
+    ManagerResult Scope(DataCenterID dataCenterID, DataCenter** scope);     // nullptr for a data center without servers
 };
 
 #endif //DATACENTERS_WET2_DATACENTERSMANAGER_H
@@ -0,0 +1,114 @@
+#include <cstring>
+#include <new>
+#include "FlatRankArray.h"
+
+const int MIN_FLAT_CAPACITY = 4;
+
+FlatRankArray::FlatRankArray(const FlatRankArray& other) : keys(nullptr), prefix(nullptr), count(0), capacity(0) {
+    Assign(other.keys, other.count);
+}
+
+FlatRankArray& FlatRankArray::operator=(const FlatRankArray& other) {
+    if (this == &other) return *this;
+    Assign(other.keys, other.count);
+    return *this;
+}
+
+FlatRankArray::~FlatRankArray() {
+    delete[] keys;
+    delete[] prefix;
+}
+
+AVLResult FlatRankArray::insert(const ServerKey& key) {
+    int position = Position(key);
+    if (position < count && !(key < keys[position])) return AVL_ALREADY_EXIST;
+    if (count == capacity) Reserve(capacity < MIN_FLAT_CAPACITY ? MIN_FLAT_CAPACITY : 2 * capacity);
+
+    // shift the tail up, the prefix sums after the new key grow by its traffic
+    memmove(keys + position + 1, keys + position, (count - position) * sizeof(ServerKey));
+    memmove(prefix + position + 2, prefix + position + 1, (count - position) * sizeof(int));
+    keys[position] = key;
+    count++;
+    prefix[position + 1] = prefix[position] + key.traffic;
+    for (int i = position + 2; i <= count; i++) prefix[i] += key.traffic;
+    return AVL_SUCCESS;
+}
+
+AVLResult FlatRankArray::remove(const ServerKey& key) {
+    int position = Position(key);
+    if (position == count || key < keys[position]) return AVL_NOT_EXIST;
+
+    // shift the tail down, the prefix sums after the key shrink by its traffic
+    int traffic = keys[position].traffic;
+    memmove(keys + position, keys + position + 1, (count - position - 1) * sizeof(ServerKey));
+    memmove(prefix + position + 1, prefix + position + 2, (count - position - 1) * sizeof(int));
+    count--;
+    for (int i = position + 1; i <= count; i++) prefix[i] -= traffic;
+    return AVL_SUCCESS;
+}
+
+int FlatRankArray::SumHighestTrafficServers(int k) const {
+    if (k <= 0 || count == 0) return 0;
+    if (k >= count) return prefix[count];
+    return prefix[count] - prefix[count - k];
+}
+
+void FlatRankArray::TrafficAtLeast(int traffic, int* count, int* sum) const {
+    int position = Position(ServerKey(traffic, 0));     // below every key with this traffic
+    *count = this->count - position;
+    *sum = (this->count == 0) ? 0 : prefix[this->count] - prefix[position];
+}
+
+int FlatRankArray::HighestTraffics(int k, int* traffics) const {
+    int taken = 0;
+    for (int i = count - 1; i >= 0 && taken < k; i--) traffics[taken++] = keys[i].traffic;
+    return taken;
+}
+
+void FlatRankArray::Assign(const ServerKey* sorted, int sortedCount) {
+    if (sortedCount > capacity) Reserve(sortedCount);
+    for (int i = 0; i < sortedCount; i++) {
+        keys[i] = sorted[i];
+        prefix[i + 1] = prefix[i] + sorted[i].traffic;
+    }
+    count = sortedCount;
+}
+
+void FlatRankArray::Clear() {
+    delete[] keys;
+    delete[] prefix;
+    keys = nullptr;
+    prefix = nullptr;
+    count = capacity = 0;
+}
+
+int FlatRankArray::Position(const ServerKey& key) const {
+    int low = 0, high = count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (keys[middle] < key) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+void FlatRankArray::Reserve(int newCapacity) {
+    auto newKeys = new ServerKey[newCapacity];
+    int* newPrefix;
+    try {
+        newPrefix = new int[newCapacity + 1];
+    } catch (std::bad_alloc& ba) {
+        delete[] newKeys;
+        throw;
+    }
+
+    if (count > 0) memcpy(newKeys, keys, count * sizeof(ServerKey));
+    newPrefix[0] = 0;
+    if (count > 0) memcpy(newPrefix + 1, prefix + 1, count * sizeof(int));
+
+    delete[] keys;
+    delete[] prefix;
+    keys = newKeys;
+    prefix = newPrefix;
+    capacity = newCapacity;
+}
@@ -0,0 +1,50 @@
+#ifndef DATACENTERS_WET2_FLATRANKARRAY_H
+#define DATACENTERS_WET2_FLATRANKARRAY_H
+
+#include "AVL.h"
+
+// The rank tree of a small data center: its keys in a sorted array, with the prefix sums of their traffic.
+// A top-k sum is a subtraction, and an update shifts the tail of the arrays (memmove).
+// The arrays grow by doubling, so an empty one takes no memory.
+class FlatRankArray {
+public:
+    FlatRankArray() : keys(nullptr), prefix(nullptr), count(0), capacity(0) {}
+    FlatRankArray(const FlatRankArray& other);
+    FlatRankArray& operator=(const FlatRankArray& other);
+    ~FlatRankArray();
+
+    AVLResult insert(const ServerKey& key);
+    AVLResult remove(const ServerKey& key);
+    int SumHighestTrafficServers(int k) const;
+    void TrafficAtLeast(int traffic, int* count, int* sum) const;   // the keys with at least this traffic
+    const ServerKey& SelectHighest(int k) const { return keys[count - k]; }   // the k-th highest key, 1 <= k <= size
+    int HighestTraffics(int k, int* traffics) const;   // the k highest traffics, descending. returns how many
+    int Size() const { return count; }
+    const ServerKey* Keys() const { return keys; }     // ascending
+    void Assign(const ServerKey* sorted, int sortedCount);
+    void Clear();
+    void Reserve(int newCapacity);  // keeps the keys, newCapacity isn't smaller than Size()
+
+    template<class Function>
+    void ForEach(Function function) const { for (int i = 0; i < count; i++) function(keys[i]); }   // ascending order
+    template<class Function>
+    void ForEachDown(const ServerKey* upper, Function function) const;  // see BPlusTree::ForEachDown
+
+private:
+    ServerKey* keys;
+    int* prefix;    // prefix[i] is the traffic of keys[0..i)
+    int count, capacity;
+
+    int Position(const ServerKey& key) const;   // the first key that isn't smaller
+};
+
+template<class Function>
+void FlatRankArray::ForEachDown(const ServerKey* upper, Function function) const {
+    int i = count - 1;
+    while (upper && i >= 0 && *upper < keys[i]) i--;
+    for (; i >= 0; i--) {
+        if (!function(keys[i])) return;
+    }
+}
+
+#endif //DATACENTERS_WET2_FLATRANKARRAY_H
@@ -2,6 +2,7 @@
 #define DATACENTERS_WET2_HASHTABLE_H
 
 #include <new>
+#include "Parallel.h"
 
 const int INITIAL_SIZE = 3;
 const int RESIZE_FACTOR = 2;    // by how much we enlarge/shrink the dynamic table
@@ -27,9 +28,12 @@ public:
     ~HashTable() { delete[] lists; }    // Destroy all lists in the array
     DataType& Find(int key);
     bool Contains(int key);
+    int Size() const { return elemCount; }
     HashTableResult Insert(int key, DataType data);
     HashTableResult Delete(int key);
     static HashTable Merge(const HashTable& table1, const HashTable& table2);
+    template<class Function>
+    void ForEach(Function function) const; // calls function(key, data) for every element
 
 private:
     struct Node {
@@ -60,6 +64,7 @@ private:
     void Resize(int new_size);
     HashTableResult InsertNoCheck(int key, DataType data);
     void InsertAllElements(const HashTable& other);
+    void ParallelInsertAllElements(const HashTable& table1, const HashTable& table2);
 };
 
 //--------------------------- LIST FUNCTIONS -----------------------
@@ -139,7 +144,12 @@ HashTableResult HashTable<DataType>::List::Remove(int key) {
 
 template<class DataType>
 HashTable<DataType>::HashTable(const HashTable<DataType>& other) : size(other.size), elemCount(0), lists(new List[other.size]) {
-    InsertAllElements(other);
+    try {
+        InsertAllElements(other);
+    } catch (std::bad_alloc& ba) {
+        delete[] lists;     // the destructor doesn't run for a constructor that threw
+        throw;
+    }
 }
 
 template<class DataType>
@@ -210,12 +220,29 @@ HashTable<DataType> HashTable<DataType>::Merge(const HashTable<DataType>& table1
         HashTable<DataType> new_table(new_size);
 
         // insert all elements from both tables into the new table
-        new_table.InsertAllElements(table1);
-        new_table.InsertAllElements(table2);
+        if (count1 > PARALLEL_MERGE_THRESHOLD && count2 > PARALLEL_MERGE_THRESHOLD) {
+            new_table.ParallelInsertAllElements(table1, table2);
+        } else {
+            new_table.InsertAllElements(table1);
+            new_table.InsertAllElements(table2);
+        }
         return new_table;
     }
 }
 
+template<class DataType>
+template<class Function>
+void HashTable<DataType>::ForEach(Function function) const {
+    // go through every list in the table
+    for (int i = 0; i < size; i++) {
+        Node* ptr = lists[i].first;
+        while (ptr != nullptr) {
+            function(ptr->key, ptr->data);
+            ptr = ptr->next;
+        }
+    }
+}
+
 //--------------------------- PRIVATE TABLE FUNCTIONS -----------------------
 
 template<class DataType>
@@ -266,4 +293,76 @@ void HashTable<DataType>::InsertAllElements(const HashTable& other) {
     }
 }
 
+template<class DataType>
+void HashTable<DataType>::ParallelInsertAllElements(const HashTable& table1, const HashTable& table2) {
+    // the table is big enough for both tables, so it never resizes here.
+    // thread p owns the lists whose index * threadsNum / size == p, so no two threads touch the same list
+    int threadsNum = ParallelThreadsNum();
+    int sourceLists = table1.size + table2.size;
+    int total = table1.elemCount + table2.elemCount;
+    auto sourceList = [&](int i) -> const List& { return (i < table1.size) ? table1.lists[i] : table2.lists[i - table1.size]; };
+    auto partitionOf = [&](int key) { return (int)((long)HashFunc(key) * threadsNum / size); };
+
+    auto offsets = new int[threadsNum * threadsNum]();    // offsets[t * threadsNum + p]
+    int* partitionBegin = nullptr;
+    const Node** sorted = nullptr;
+    bool inserting = false;
+    try {
+        partitionBegin = new int[threadsNum + 1];
+        sorted = new const Node*[total];
+
+        // 1. every thread counts how many of the elements in its slice of the source lists go to each partition
+        ParallelFor(threadsNum, [&](int t) {
+            int first = (int)((long)sourceLists * t / threadsNum), last = (int)((long)sourceLists * (t + 1) / threadsNum);
+            for (int i = first; i < last; i++) {
+                for (Node* ptr = sourceList(i).first; ptr != nullptr; ptr = ptr->next) offsets[t * threadsNum + partitionOf(ptr->key)]++;
+            }
+        });
+
+        // turn the counts into offsets in a single array sorted by partition
+        int offset = 0;
+        for (int p = 0; p < threadsNum; p++) {
+            partitionBegin[p] = offset;
+            for (int t = 0; t < threadsNum; t++) {
+                int count = offsets[t * threadsNum + p];
+                offsets[t * threadsNum + p] = offset;
+                offset += count;
+            }
+        }
+        partitionBegin[threadsNum] = offset;
+
+        // 2. every thread puts the elements of its slice in their places
+        ParallelFor(threadsNum, [&](int t) {
+            int first = (int)((long)sourceLists * t / threadsNum), last = (int)((long)sourceLists * (t + 1) / threadsNum);
+            for (int i = first; i < last; i++) {
+                for (Node* ptr = sourceList(i).first; ptr != nullptr; ptr = ptr->next) sorted[offsets[t * threadsNum + partitionOf(ptr->key)]++] = ptr;
+            }
+        });
+
+        // 3. every thread inserts the elements of its own partition. offsets[p] counts them from here, so the
+        // table's count stays right if a thread runs out of memory
+        for (int p = 0; p < threadsNum; p++) offsets[p] = 0;
+        inserting = true;
+        ParallelFor(threadsNum, [&](int p) {
+            for (int i = partitionBegin[p]; i < partitionBegin[p + 1]; i++) {
+                lists[HashFunc(sorted[i]->key)].AddFirst(sorted[i]->key, sorted[i]->data);
+                offsets[p]++;
+            }
+        });
+        elemCount += total;
+    } catch (std::bad_alloc& ba) {
+        if (inserting) {
+            for (int p = 0; p < threadsNum; p++) elemCount += offsets[p];
+        }
+        delete[] sorted;
+        delete[] partitionBegin;
+        delete[] offsets;
+        throw;
+    }
+
+    delete[] sorted;
+    delete[] partitionBegin;
+    delete[] offsets;
+}
+
 #endif //DATACENTERS_WET2_HASHTABLE_H
@@ -0,0 +1,207 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Journal.h"
+
+const int JOURNAL_HEADER_SIZE = 2 * sizeof(int);    // magic + generation
+
+//--------------------------- JOURNAL FUNCTIONS -----------------------
+
+Journal::Journal(const char* journalPath, const char* snapshotPath) :
+        journalPath(CopyPath(journalPath)),
+        snapshotPath(CopyPath(snapshotPath)),
+        fd(-1), generation(0), pending(0), capacity(JOURNAL_GROUP_SIZE),
+        group(new JournalRecord[JOURNAL_GROUP_SIZE]), failed(false) {}
+
+Journal::~Journal() {
+    if (fd != -1) {
+        Commit();   // don't lose the last (partial) group on a clean shutdown
+        close(fd);
+    }
+    delete[] group;
+    delete[] journalPath;
+    delete[] snapshotPath;
+}
+
+JournalResult Journal::Open(int new_generation) {
+    fd = open(journalPath, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd == -1) return J_FAILURE;
+
+    // check the existing header
+    int header[2] = {0, 0};
+    long size = lseek(fd, 0, SEEK_END);
+    if (size < JOURNAL_HEADER_SIZE || pread(fd, header, JOURNAL_HEADER_SIZE, 0) != JOURNAL_HEADER_SIZE ||
+        header[0] != JOURNAL_MAGIC || header[1] != new_generation) {
+        // no journal, or a journal that is older than the snapshot - start a new one
+        return Restart(new_generation);
+    }
+
+    // drop a partially written record left by a crash, so new records stay aligned
+    long records = (size - JOURNAL_HEADER_SIZE) / (long)sizeof(JournalRecord);
+    long aligned = JOURNAL_HEADER_SIZE + records * (long)sizeof(JournalRecord);
+    if (aligned != size && ftruncate(fd, aligned) != 0) return J_FAILURE;
+
+    generation = new_generation;
+    return J_SUCCESS;
+}
+
+JournalResult Journal::Reserve(int records) {
+    if (!Writable()) return J_FAILURE;
+    if (pending + records <= capacity) return J_SUCCESS;
+    if (pending > 0 && Commit() != J_SUCCESS) return J_FAILURE;
+    if (records <= capacity) return J_SUCCESS;
+
+    // a batch bigger than a group is kept whole, so none of its records can be dropped
+    auto bigger = new JournalRecord[records];
+    delete[] group;
+    group = bigger;
+    capacity = records;
+    return J_SUCCESS;
+}
+
+JournalResult Journal::Append(JournalOp op, int arg1, int arg2) {
+    // a full group that failed is committed first. if it can't be, there is no room for the record
+    if (pending == capacity && Commit() != J_SUCCESS) {
+        Close();
+        return J_FAILURE;
+    }
+
+    JournalRecord& record = group[pending++];
+    record.op = op;
+    record.arg1 = arg1;
+    record.arg2 = arg2;
+
+    // the group is full - commit it with a single write and a single fsync. if that fails, a reserved
+    // batch goes on filling the group and it's tried again once the batch fills it
+    if (pending == JOURNAL_GROUP_SIZE || pending == capacity) Commit();
+    return J_SUCCESS;
+}
+
+JournalResult Journal::Commit() {
+    if (fd == -1) {
+        failed = true;  // closed for good, see Close
+        return J_FAILURE;
+    }
+    if (pending == 0) return J_SUCCESS;
+    failed = true;
+
+    // a group that isn't durable is cut off the file and kept, so the log never has a hole
+    long size = lseek(fd, 0, SEEK_END);
+    if (size == -1) return J_FAILURE;
+    if (!WriteAll(fd, group, (long)pending * (long)sizeof(JournalRecord)) || fsync(fd) != 0) {
+        if (ftruncate(fd, size) != 0) Close();  // the file can't be fixed, nothing more is written to it
+        return J_FAILURE;
+    }
+
+    pending = 0;
+    failed = false;
+    return J_SUCCESS;
+}
+
+bool Journal::Writable() {
+    return !failed || Commit() == J_SUCCESS;
+}
+
+JournalResult Journal::Restart(int new_generation) {
+    // the new journal is written aside and renamed into place, so the file always has a whole header
+    auto tmpPath = new char[strlen(journalPath) + 5];
+    strcpy(tmpPath, journalPath);
+    strcat(tmpPath, ".tmp");
+
+    int header[2] = {JOURNAL_MAGIC, new_generation};
+    int newFd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    bool ok = (newFd != -1) && WriteAll(newFd, header, JOURNAL_HEADER_SIZE) && fsync(newFd) == 0 &&
+              rename(tmpPath, journalPath) == 0;
+    if (!ok) {
+        if (newFd != -1) {
+            close(newFd);
+            unlink(tmpPath);
+        }
+        delete[] tmpPath;
+
+        // the snapshot of the new generation may be saved already, and the recovery would skip
+        // whatever is appended to the old journal now
+        Close();
+        return J_FAILURE;
+    }
+    delete[] tmpPath;
+
+    // everything before the restart is already in the snapshot
+    if (fd != -1) close(fd);
+    fd = newFd;
+    generation = new_generation;
+    pending = 0;
+    failed = false;
+    return J_SUCCESS;
+}
+
+void Journal::Close() {
+    if (fd != -1) close(fd);
+    fd = -1;
+    failed = true;
+}
+
+bool Journal::WriteAll(int fd, const void* data, long bytes) {
+    auto ptr = (const char*)data;
+    while (bytes > 0) {
+        long written = write(fd, ptr, bytes);
+        if (written <= 0) return false;
+        ptr += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+long Journal::ReadAll(int fd, void* data, long bytes) {
+    auto ptr = (char*)data;
+    long total = 0;
+    while (total < bytes) {
+        long got = read(fd, ptr + total, bytes - total);
+        if (got <= 0) break;    // EOF (or error)
+        total += got;
+    }
+    return total;
+}
+
+char* Journal::CopyPath(const char* path) {
+    auto copy = new char[strlen(path) + 1];
+    strcpy(copy, path);
+    return copy;
+}
+
+//--------------------------- READER FUNCTIONS -----------------------
+
+Journal::Reader::Reader(const char* path) : fd(open(path, O_RDONLY)), generation(0), count(0), next(0), group(nullptr) {
+    if (fd == -1) return;   // no journal
+
+    int header[2] = {0, 0};
+    if (ReadAll(fd, header, JOURNAL_HEADER_SIZE) != JOURNAL_HEADER_SIZE || header[0] != JOURNAL_MAGIC) {
+        close(fd);  // not a journal
+        fd = -1;
+        return;
+    }
+
+    generation = header[1];
+    group = new JournalRecord[JOURNAL_GROUP_SIZE];
+}
+
+Journal::Reader::~Reader() {
+    if (fd != -1) close(fd);
+    delete[] group;
+}
+
+bool Journal::Reader::Next(JournalRecord* record) {
+    if (fd == -1) return false;
+
+    // read the next group from the file
+    if (next == count) {
+        long bytes = ReadAll(fd, group, (long)JOURNAL_GROUP_SIZE * (long)sizeof(JournalRecord));
+        count = (int)(bytes / (long)sizeof(JournalRecord));   // a torn record at the tail is ignored
+        next = 0;
+        if (count == 0) return false;
+    }
+
+    *record = group[next++];
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef DATACENTERS_WET2_JOURNAL_H
+#define DATACENTERS_WET2_JOURNAL_H
+
+const int JOURNAL_MAGIC = 0x4A524E4C;    // "JRNL"
+const int SNAPSHOT_MAGIC = 0x534E4150;   // "SNAP"
+
+const int JOURNAL_GROUP_SIZE = 4096;     // how many records are committed together by one fsync
+
+enum JournalResult {
+    J_SUCCESS,
+    J_FAILURE
+};
+
+enum JournalOp {
+    J_ADD_SERVER = 1,
+    J_REMOVE_SERVER = 2,
+    J_SET_TRAFFIC = 3,
+    J_MERGE_DATA_CENTERS = 4,
+    J_ADD_DATA_CENTER = 5,
+    J_MOVE_SERVER = 6
+};
+
+struct JournalRecord {
+    int op;
+    int arg1, arg2;
+};
+
+// Append-only log of successful mutations.
+// Records are buffered in memory and written + fsync'ed together once a group is full (group commit),
+// so a crash loses at most the last uncommitted group.
+// Every journal carries a generation number. A checkpoint writes a snapshot tagged with the next generation
+// and only then restarts the journal, so a journal older than its snapshot is known to be already applied.
+class Journal {
+public:
+    Journal(const char* journalPath, const char* snapshotPath);
+    ~Journal();
+    Journal(const Journal& other) = delete;
+    Journal& operator=(const Journal& other) = delete;
+
+    JournalResult Open(int new_generation);
+    // makes room for the records of a mutation before it changes anything: J_FAILURE if a group that failed
+    // can't be committed. throws bad_alloc if more than a group's worth doesn't fit
+    JournalResult Reserve(int records);
+    // a group that gets full is committed. if that fails the group (and the record) is kept and committed again
+    // by the next Commit or Reserve. J_FAILURE only if there was no room reserved and the record is dropped:
+    // the journal is then closed
+    JournalResult Append(JournalOp op, int arg1, int arg2);
+    JournalResult Commit();     // on failure the group is kept and nothing of it stays in the file
+    bool Writable();    // false while a group that failed can't be committed, nothing should be appended then
+    // starts an empty journal of the new generation in place of this one. on failure the journal is closed
+    // and never Writable again, unless a later Restart succeeds
+    JournalResult Restart(int new_generation);
+    int Generation() const { return generation; }
+    const char* SnapshotPath() const { return snapshotPath; }
+
+    class Reader {
+    public:
+        explicit Reader(const char* path);
+        ~Reader();
+        Reader(const Reader& other) = delete;
+        Reader& operator=(const Reader& other) = delete;
+
+        bool IsOpen() const { return fd != -1; }
+        int Generation() const { return generation; }
+        bool Next(JournalRecord* record);    // false when no complete record is left
+
+    private:
+        int fd;
+        int generation;
+        int count, next;
+        JournalRecord* group;
+    };
+
+    // whole-buffer I/O helpers (also used for snapshots)
+    static bool WriteAll(int fd, const void* data, long bytes);
+    static long ReadAll(int fd, void* data, long bytes);
+
+private:
+    char* journalPath;
+    char* snapshotPath;
+    int fd;
+    int generation;
+    int pending;
+    int capacity;   // of group, at least JOURNAL_GROUP_SIZE
+    JournalRecord* group;
+    bool failed;    // the last commit failed
+
+    void Close();   // nothing more is written, every commit fails
+    static char* CopyPath(const char* path);
+};
+
+#endif //DATACENTERS_WET2_JOURNAL_H
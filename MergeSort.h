@@ -0,0 +1,21 @@
+#ifndef DATACENTERS_WET2_MERGESORT_H
+#define DATACENTERS_WET2_MERGESORT_H
+
+// sorts items by their operator<, stable. helper has room for count items
+template<class Item>
+void MergeSort(Item* items, Item* helper, int count) {
+    // bottom up, every pass merges runs of width into runs of twice that
+    for (int width = 1; width < count; width *= 2) {
+        for (int first = 0; first < count; first += 2 * width) {
+            int middle = first + width < count ? first + width : count;
+            int last = middle + width < count ? middle + width : count;
+            int i = first, j = middle, out = first;
+            while (i < middle && j < last) helper[out++] = items[j] < items[i] ? items[j++] : items[i++];
+            while (i < middle) helper[out++] = items[i++];
+            while (j < last) helper[out++] = items[j++];
+        }
+        for (int i = 0; i < count; i++) items[i] = helper[i];
+    }
+}
+
+#endif //DATACENTERS_WET2_MERGESORT_H
@@ -0,0 +1,52 @@
+#ifndef DATACENTERS_WET2_PARALLEL_H
+#define DATACENTERS_WET2_PARALLEL_H
+
+#include <exception>
+#include <new>
+#include <thread>
+
+const int PARALLEL_MERGE_THRESHOLD = 1 << 16;   // merges where both sides are bigger than this go parallel
+const int PARALLEL_REPORT_THRESHOLD = 1 << 12; // fleet reports over more data centers than this go parallel
+const int MAX_PARALLEL_THREADS = 8;
+
+inline int ParallelThreadsNum() {
+    int threadsNum = (int)std::thread::hardware_concurrency();  // 0 if unknown
+    if (threadsNum < 2) threadsNum = 2;
+    if (threadsNum > MAX_PARALLEL_THREADS) threadsNum = MAX_PARALLEL_THREADS;
+    return threadsNum;
+}
+
+// calls function(0), ..., function(tasksNum - 1), each on its own thread (task 0 on the calling thread).
+// tasks that no thread could be started for run on the calling thread too.
+// if any task threw, the first one's exception is rethrown after all the tasks are done.
+template<class Function>
+void ParallelFor(int tasksNum, Function function) {
+    auto errors = new std::exception_ptr[tasksNum];
+    auto task = [&](int i) {
+        try {
+            function(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::thread* threads = nullptr;
+    int started = 0;
+    try {
+        threads = new std::thread[tasksNum - 1];
+        for (; started < tasksNum - 1; started++) threads[started] = std::thread(task, started + 1);
+    } catch (...) {
+        // no more threads
+    }
+    task(0);
+    for (int i = started + 1; i < tasksNum; i++) task(i);
+    for (int i = 0; i < started; i++) threads[i].join();
+    delete[] threads;
+
+    std::exception_ptr error;
+    for (int i = 0; i < tasksNum && !error; i++) error = errors[i];
+    delete[] errors;
+    if (error) std::rethrow_exception(error);
+}
+
+#endif //DATACENTERS_WET2_PARALLEL_H
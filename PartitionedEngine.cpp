@@ -0,0 +1,449 @@
+#include <new>
+#include "PartitionedEngine.h"
+
+//--------------------------- ENGINE FUNCTIONS -----------------------
+
+PartitionedEngine::PartitionedEngine(int size, int workersNum) :
+        dataCenterNum(size), workersNum(workersNum), ids(size), directory(),
+        owners(size, -1), serverCounts(size, 0),
+        workers(new Worker*[workersNum]), threads(new std::thread[workersNum]),
+        probes(new int[workersNum * PROBE_THRESHOLDS * 2]), probesDone(new std::atomic<int>[workersNum]) {
+    for (int i = 0; i < workersNum; i++) workers[i] = new Worker(size);
+    for (int i = 0; i < workersNum; i++) threads[i] = std::thread(&Worker::Run, workers[i]);
+}
+
+PartitionedEngine::~PartitionedEngine() {
+    Task stop = Task();
+    stop.op = T_STOP;
+    for (int i = 0; i < workersNum; i++) workers[i]->Post(stop);
+    for (int i = 0; i < workersNum; i++) threads[i].join();
+    for (int i = 0; i < workersNum; i++) delete workers[i];
+
+    delete[] probesDone;
+    delete[] probes;
+    delete[] threads;
+    delete[] workers;
+}
+
+EngineResult PartitionedEngine::AddDataCenter(DataCenterID* dataCenterID) {
+    if (!dataCenterID) return E_INVALID_INPUT;
+    if (dataCenterNum == MAX_DATA_CENTERS) return E_FAILURE;
+
+    // the workers grow their own slots when the new data center is first used
+    owners.Grow(dataCenterNum + 1);
+    serverCounts.Grow(dataCenterNum + 1);
+    ids.Grow(dataCenterNum + 1);
+    *dataCenterID = ++dataCenterNum;
+    return E_SUCCESS;
+}
+
+EngineResult PartitionedEngine::MergeDataCenters(DataCenterID dataCenter1, DataCenterID dataCenter2) {
+    if (dataCenter1 <= 0 || dataCenter1 > dataCenterNum || dataCenter2 <= 0 || dataCenter2 > dataCenterNum) return E_INVALID_INPUT;
+    if (Error() != E_SUCCESS) return Error();
+
+    int root1 = ids.Find(dataCenter1), root2 = ids.Find(dataCenter2);
+    if (root1 == root2) return E_SUCCESS;
+
+    int worker1 = Owner(root1), worker2 = Owner(root2);
+    int newRoot;
+
+    Task task = Task();
+    if (worker1 == worker2) {
+        // both on the same worker - a local merge
+        newRoot = ids.Union(root1, root2);
+        task.op = T_MERGE;
+        task.root = root1;
+        task.otherRoot = root2;
+        task.arg1 = newRoot;
+        workers[worker1]->Post(task);
+        owners[newRoot] = worker1;
+    } else {
+        // migrate the side with less servers to the worker of the other side
+        int from = root1, to = root2;
+        if (serverCounts.Get(root1) > serverCounts.Get(root2)) {
+            from = root2;
+            to = root1;
+        }
+
+        std::atomic<int> done(0);
+        task.op = T_EXTRACT;
+        task.root = from;
+        task.extracted = &task.manager;
+        task.done = &done;
+        workers[Owner(from)]->Post(task);
+        Wait(done);
+        if (workers[Owner(from)]->Error() != E_SUCCESS) return workers[Owner(from)]->Error();   // nothing was extracted
+
+        // united only once the data center left its worker, the IDs don't change if it didn't
+        newRoot = ids.Union(root1, root2);
+        task.op = T_ADOPT;
+        task.root = to;
+        task.arg1 = newRoot;
+        task.extracted = nullptr;
+        task.done = nullptr;
+        workers[Owner(to)]->Post(task);    // the worker takes ownership of task.manager
+        owners[newRoot] = Owner(to);
+    }
+
+    serverCounts[newRoot] = serverCounts.Get(root1) + serverCounts.Get(root2);
+    return E_SUCCESS;
+}
+
+EngineResult PartitionedEngine::AddServer(DataCenterID dataCenterID, ServerID serverID) {
+    if (dataCenterID <= 0 || dataCenterID > dataCenterNum || serverID <= 0) return E_INVALID_INPUT;
+    if (Error() != E_SUCCESS) return Error();
+    if (directory.Insert(serverID, dataCenterID) != HASH_SUCCESS) return E_FAILURE;
+
+    int root = ids.Find(dataCenterID);
+    serverCounts[root]++;
+
+    Task task = Task();
+    task.op = T_ADD_SERVER;
+    task.root = root;
+    task.arg1 = dataCenterID;
+    task.arg2 = serverID;
+    workers[Owner(root)]->Post(task);
+
+    return E_SUCCESS;
+}
+
+EngineResult PartitionedEngine::RemoveServer(ServerID serverID) {
+    if (serverID <= 0) return E_INVALID_INPUT;
+    if (Error() != E_SUCCESS) return Error();
+    if (!directory.Contains(serverID)) return E_FAILURE;
+
+    int root = ids.Find(directory.Find(serverID));
+    directory.Delete(serverID);
+    serverCounts[root]--;
+
+    Task task = Task();
+    task.op = T_REMOVE_SERVER;
+    task.root = root;
+    task.arg1 = serverID;
+    workers[Owner(root)]->Post(task);
+
+    return E_SUCCESS;
+}
+
+EngineResult PartitionedEngine::SetTraffic(ServerID serverID, int traffic) {
+    if (serverID <= 0 || traffic < 0) return E_INVALID_INPUT;
+    if (Error() != E_SUCCESS) return Error();
+    if (!directory.Contains(serverID)) return E_FAILURE;
+
+    int root = ids.Find(directory.Find(serverID));
+
+    Task task = Task();
+    task.op = T_SET_TRAFFIC;
+    task.root = root;
+    task.arg1 = serverID;
+    task.arg2 = traffic;
+    workers[Owner(root)]->Post(task);
+
+    return E_SUCCESS;
+}
+
+EngineResult PartitionedEngine::SumHighestTrafficServers(DataCenterID dataCenterID, int k, int* traffic) {
+    if (dataCenterID < 0 || dataCenterID > dataCenterNum || k < 0 || !traffic) return E_INVALID_INPUT;
+    if (Error() != E_SUCCESS) return Error();
+
+    Task task = Task();
+    if (dataCenterID != 0) {
+        // ask the owner. the queue is FIFO so the answer includes every mutation posted before
+        std::atomic<int> done(0);
+        int root = ids.Find(dataCenterID);
+        task.op = T_SUM_HIGHEST;
+        task.root = root;
+        task.arg1 = k;
+        task.result = traffic;
+        task.done = &done;
+        workers[Owner(root)]->Post(task);
+        Wait(done);
+        return workers[Owner(root)]->Error();
+    }
+
+    if (k == 0) {
+        *traffic = 0;
+        return E_SUCCESS;
+    }
+    return SumHighestTrafficServers(k, traffic);
+}
+
+EngineResult PartitionedEngine::FreezeDataCenter(DataCenterID dataCenterID) {
+    if (dataCenterID < 0 || dataCenterID > dataCenterNum) return E_INVALID_INPUT;
+    if (Error() != E_SUCCESS) return Error();
+
+    Task task = Task();
+    task.op = T_FREEZE;
+    if (dataCenterID == 0) {
+        task.root = -1;
+        for (int i = 0; i < workersNum; i++) workers[i]->Post(task);
+        return E_SUCCESS;
+    }
+
+    int root = ids.Find(dataCenterID);
+    task.root = root;
+    workers[Owner(root)]->Post(task);
+    return E_SUCCESS;
+}
+
+int PartitionedEngine::Owner(int root) const {
+    // data centers are spread round robin until a merge moves them
+    int owner = owners.Get(root);
+    return (owner == -1) ? root % workersNum : owner;
+}
+
+EngineResult PartitionedEngine::Error() const {
+    for (int i = 0; i < workersNum; i++) {
+        if (workers[i]->Error() != E_SUCCESS) return workers[i]->Error();
+    }
+    return E_SUCCESS;
+}
+
+EngineResult PartitionedEngine::Probe(TaskOp op, int arg1, int arg2) {
+    // the queues are FIFO so the answers include every mutation posted before
+    Task task = Task();
+    task.op = op;
+    task.arg1 = arg1;
+    task.arg2 = arg2;
+    task.thresholds = thresholds;
+    for (int i = 0; i < workersNum; i++) {
+        probesDone[i] = 0;
+        task.result = probes + i * PROBE_THRESHOLDS * 2;
+        task.done = probesDone + i;
+        workers[i]->Post(task);
+    }
+    for (int i = 0; i < workersNum; i++) Wait(probesDone[i]);
+    return Error();
+}
+
+EngineResult PartitionedEngine::SumHighestTrafficServers(int k, int* traffic) {
+    // the k highest traffics are every traffic above the k-th highest and some of the servers at it.
+    // it's the highest threshold with at least k servers at or above it: a worker with k servers at or above
+    // some traffic bounds it from below, and a worker with ceil(k / workersNum) of the k highest from above
+    int spread = (k + workersNum - 1) / workersNum;
+    EngineResult result = Probe(T_TRAFFIC_RANKS, k, spread);
+    if (result != E_SUCCESS) return result;
+
+    int count = 0, sum = 0, low = 1, high = 0;
+    for (int i = 0; i < workersNum; i++) {
+        int* answer = probes + i * PROBE_THRESHOLDS * 2;
+        count += answer[0];
+        sum += answer[1];
+        if (answer[2] > low) low = answer[2];
+        if (answer[3] > high) high = answer[3];
+    }
+    if (k >= count) {
+        *traffic = sum;     // and servers without traffic
+        return E_SUCCESS;
+    }
+
+    // every round probes thresholds spread over (low, high], and keeps the range between two of them.
+    // above is the count and sum at or above high + 1, once it's known
+    int aboveCount = -1, aboveSum = 0;
+    while (low < high) {
+        int thresholdsNum = 0;
+        for (int i = 1; i <= PROBE_THRESHOLDS; i++) {
+            int threshold = low + (int)(((long)(high - low) * i + PROBE_THRESHOLDS) / (PROBE_THRESHOLDS + 1));
+            if (threshold > high) break;
+            if (thresholdsNum == 0 || threshold > thresholds[thresholdsNum - 1]) thresholds[thresholdsNum++] = threshold;
+        }
+        if ((result = Probe(T_TRAFFIC_AT_LEAST, thresholdsNum, 0)) != E_SUCCESS) return result;
+
+        for (int j = 0; j < thresholdsNum; j++) {
+            int thresholdCount = 0, thresholdSum = 0;
+            for (int i = 0; i < workersNum; i++) {
+                thresholdCount += probes[i * PROBE_THRESHOLDS * 2 + j * 2];
+                thresholdSum += probes[i * PROBE_THRESHOLDS * 2 + j * 2 + 1];
+            }
+            if (thresholdCount >= k) {
+                low = thresholds[j];
+            } else {
+                high = thresholds[j] - 1;     // the thresholds ascend, so the first one below k is the tightest
+                aboveCount = thresholdCount;
+                aboveSum = thresholdSum;
+                break;
+            }
+        }
+    }
+
+    if (aboveCount == -1 && low == INT_MAX) {
+        aboveCount = aboveSum = 0;
+    } else if (aboveCount == -1) {
+        thresholds[0] = low + 1;
+        if ((result = Probe(T_TRAFFIC_AT_LEAST, 1, 0)) != E_SUCCESS) return result;
+        aboveCount = aboveSum = 0;
+        for (int i = 0; i < workersNum; i++) {
+            aboveCount += probes[i * PROBE_THRESHOLDS * 2];
+            aboveSum += probes[i * PROBE_THRESHOLDS * 2 + 1];
+        }
+    }
+    *traffic = aboveSum + (k - aboveCount) * low;
+    return E_SUCCESS;
+}
+
+void PartitionedEngine::Wait(std::atomic<int>& done) {
+    while (done.load(std::memory_order_acquire) == 0) std::this_thread::yield();
+}
+
+//--------------------------- WORKER FUNCTIONS -----------------------
+
+PartitionedEngine::Worker::Worker(int size) :
+        centers(size, nullptr), all(),
+        head(0), tail(0), queue(new Task[TASK_QUEUE_SIZE]), sleeping(false), error(E_SUCCESS) {}
+
+PartitionedEngine::Worker::~Worker() {
+    centers.ForEach([](int, ServersManager* center) { delete center; });    // slots of data centers we don't own are nullptr
+    delete[] queue;
+}
+
+void PartitionedEngine::Worker::Post(const Task& task) {
+    // only the engine's thread posts, so the tail is ours
+    long currTail = tail.load(std::memory_order_relaxed);
+    while (currTail - head.load(std::memory_order_acquire) == TASK_QUEUE_SIZE) std::this_thread::yield();  // full
+
+    queue[currTail & (TASK_QUEUE_SIZE - 1)] = task;
+    tail.store(currTail + 1, std::memory_order_seq_cst);
+
+    // wake the worker up only if it went to sleep
+    if (sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeUp.notify_one();
+    }
+}
+
+bool PartitionedEngine::Worker::Pop(Task* task) {
+    long currHead = head.load(std::memory_order_relaxed);
+    if (currHead == tail.load(std::memory_order_acquire)) return false;   // empty
+
+    *task = queue[currHead & (TASK_QUEUE_SIZE - 1)];
+    head.store(currHead + 1, std::memory_order_release);
+    return true;
+}
+
+void PartitionedEngine::Worker::Run() {
+    Task task;
+    while (true) {
+        // poll for a while, then sleep until something is posted
+        int spins = 0;
+        while (!Pop(&task)) {
+            if (++spins < WORKER_SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.store(true, std::memory_order_seq_cst);
+            wakeUp.wait(lock, [this]() { return head.load() != tail.load(std::memory_order_seq_cst); });
+            sleeping.store(false, std::memory_order_relaxed);
+            spins = 0;
+        }
+
+        if (task.op == T_STOP) break;
+        Execute(task);
+    }
+}
+
+void PartitionedEngine::Worker::Execute(Task& task) {
+    // nothing escapes the worker's thread: the error is kept for the engine to report
+    try {
+        Apply(task);
+    } catch (std::bad_alloc& ba) {
+        error.store(E_ALLOCATION_ERROR, std::memory_order_release);
+    } catch (...) {
+        error.store(E_FAILURE, std::memory_order_release);
+    }
+
+    if (task.done) task.done->store(1, std::memory_order_release);
+}
+
+void PartitionedEngine::Worker::Apply(Task& task) {
+    switch (task.op) {
+        case T_ADD_SERVER:
+            Center(task.root).AddServer(task.arg1, task.arg2);
+            all.AddServer(task.arg1, task.arg2);
+            break;
+
+        case T_REMOVE_SERVER:
+            Center(task.root).RemoveServer(task.arg1);
+            all.RemoveServer(task.arg1);
+            break;
+
+        case T_SET_TRAFFIC:
+            Center(task.root).SetTraffic(task.arg1, task.arg2);
+            all.SetTraffic(task.arg1, task.arg2);
+            break;
+
+        case T_SUM_HIGHEST:
+            *task.result = Center(task.root).SumHighestTrafficServers(task.arg1);
+            break;
+
+        case T_TRAFFIC_RANKS:
+            all.TrafficAtLeast(1, task.result, task.result + 1);
+            task.result[2] = all.TrafficByRank(task.arg1);     // 0 if there are less servers with traffic
+            task.result[3] = all.TrafficByRank(task.arg2);
+            break;
+
+        case T_TRAFFIC_AT_LEAST:
+            for (int i = 0; i < task.arg1; i++) all.TrafficAtLeast(task.thresholds[i], task.result + i * 2, task.result + i * 2 + 1);
+            break;
+
+        case T_MERGE: {
+            auto merged = new ServersManager(ServersManager::MergeServers(Center(task.root), Center(task.otherRoot)));
+            delete Slot(task.root);
+            delete Slot(task.otherRoot);
+            Slot(task.root) = Slot(task.otherRoot) = nullptr;
+            Slot(task.arg1) = merged;   // the new root is one of the two
+            break;
+        }
+
+        case T_EXTRACT: {
+            // hand the data center over, and forget its servers
+            ServersManager*& slot = Slot(task.root);
+            ServersManager* extracted = slot ? slot : new ServersManager();
+            slot = nullptr;
+            *task.extracted = extracted;
+            extracted->ForEachServer([this](const Server& server) { all.RemoveServer(server.serverID); });
+            break;
+        }
+
+        case T_ADOPT: {
+            // take the servers of the extracted data center, and merge it with ours
+            ServersManager* merged;
+            try {
+                Slot(task.arg1);    // the new root's slot exists before anything changes
+                task.manager->ForEachServer([this](const Server& server) {
+                    all.AddServer(server.dataCenterID, server.serverID);
+                    if (server.traffic != 0) all.SetTraffic(server.serverID, server.traffic);
+                });
+                merged = new ServersManager(ServersManager::MergeServers(Center(task.root), *task.manager));
+            } catch (std::bad_alloc& ba) {
+                delete task.manager;    // it's ours
+                throw;
+            }
+            delete task.manager;
+            delete Slot(task.root);
+            Slot(task.root) = nullptr;
+            Slot(task.arg1) = merged;
+            break;
+        }
+
+        case T_FREEZE:
+            if (task.root == -1) all.Freeze();
+            else Center(task.root).Freeze();
+            break;
+
+        default:
+            break;
+    }
+}
+
+ServersManager& PartitionedEngine::Worker::Center(int root) {
+    // data centers are created the first time they are used
+    ServersManager*& slot = Slot(root);
+    if (!slot) slot = new ServersManager();
+    return *slot;
+}
+
+ServersManager*& PartitionedEngine::Worker::Slot(int root) {
+    if (root >= centers.Size()) centers.Grow(root + 1);
+    return centers[root];
+}
@@ -0,0 +1,119 @@
+#ifndef DATACENTERS_WET2_PARTITIONEDENGINE_H
+#define DATACENTERS_WET2_PARTITIONEDENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "ChunkedArray.h"
+#include "UnionFind.h"
+#include "ServersManager.h"
+
+const int TASK_QUEUE_SIZE = 4096;   // must be a power of 2
+const int WORKER_SPIN_COUNT = 1000; // how many times an idle worker polls its queue before it sleeps
+const int PROBE_THRESHOLDS = 15;    // traffics a global top-k query asks every worker about at once
+
+enum EngineResult {
+    E_SUCCESS = 0,
+    E_FAILURE = -1,
+    E_ALLOCATION_ERROR = -2,
+    E_INVALID_INPUT = -3
+};
+
+// Data centers are partitioned across worker threads. Every union-find root is owned by one worker,
+// which holds that data center's ServersManager and a ServersManager of all the servers it owns.
+// The calling thread routes every operation to the owner of the data center's root through
+// a single-producer single-consumer queue, so the workers never share data and never lock on the hot path.
+// Mutations are validated by the caller (it keeps the server directory) and are not waited for.
+// A worker that runs out of memory in a task marks itself failed, and since its data centers may
+// be missing that mutation, every later call returns E_ALLOCATION_ERROR.
+// A merge across workers migrates the side with less servers. A global top-k query searches for the traffic
+// of the k-th highest server: every round asks every worker for the count and sum of its servers at or above
+// PROBE_THRESHOLDS traffics, and the range shrinks to between two of them.
+class PartitionedEngine {
+public:
+    PartitionedEngine(int size, int workersNum);
+    ~PartitionedEngine();
+    PartitionedEngine(const PartitionedEngine& other) = delete;
+    PartitionedEngine& operator=(const PartitionedEngine& other) = delete;
+
+    EngineResult AddDataCenter(DataCenterID* dataCenterID);
+    EngineResult MergeDataCenters(DataCenterID dataCenter1, DataCenterID dataCenter2);
+    EngineResult AddServer(DataCenterID dataCenterID, ServerID serverID);
+    EngineResult RemoveServer(ServerID serverID);
+    EngineResult SetTraffic(ServerID serverID, int traffic);
+    EngineResult SumHighestTrafficServers(DataCenterID dataCenterID, int k, int* traffic);
+    EngineResult FreezeDataCenter(DataCenterID dataCenterID);
+    int DataCentersNum() const { return dataCenterNum; }
+
+private:
+    enum TaskOp {
+        T_STOP,
+        T_ADD_SERVER,
+        T_REMOVE_SERVER,
+        T_SET_TRAFFIC,
+        T_SUM_HIGHEST,      // on a single data center
+        T_TRAFFIC_RANKS,    // for a global query: the worker's count and sum, and the traffics at two ranks
+        T_TRAFFIC_AT_LEAST, // for a global query: the count and sum of the worker's servers at or above traffics
+        T_MERGE,            // both data centers are on this worker
+        T_EXTRACT,          // give away a data center
+        T_ADOPT,            // merge a data center that was extracted from another worker
+        T_FREEZE            // a data center, or all the worker's servers if root is -1
+    };
+
+    struct Task {
+        TaskOp op;
+        int root, otherRoot;            // indices in the union-find
+        int arg1, arg2;
+        int* result;
+        const int* thresholds;          // of T_TRAFFIC_AT_LEAST, arg1 of them
+        ServersManager* manager;        // the adopted data center
+        ServersManager** extracted;     // where to put the extracted data center
+        std::atomic<int>* done;         // set when a task somebody waits for is done
+    };
+
+    class Worker {
+    public:
+        explicit Worker(int size);
+        ~Worker();
+        void Post(const Task& task);
+        void Run();
+        EngineResult Error() const { return (EngineResult)error.load(std::memory_order_acquire); }
+
+    private:
+        ChunkedArray<ServersManager*> centers;  // the data centers this worker owns, by root index
+        ServersManager all;         // every server on this worker
+        std::atomic<long> head, tail;
+        Task* queue;
+        std::atomic<bool> sleeping;
+        std::atomic<int> error;     // E_SUCCESS until a task fails
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+
+        bool Pop(Task* task);
+        void Execute(Task& task);
+        void Apply(Task& task);
+        ServersManager& Center(int root);
+        ServersManager*& Slot(int root);    // grows the slots for data centers added after the worker started
+    };
+
+    int dataCenterNum;
+    int workersNum;
+    UnionFind ids;
+    HashTable<DataCenterID> directory;  // server ID -> data center ID
+    ChunkedArray<int> owners;           // the worker of every root, -1 for the round robin default
+    ChunkedArray<int> serverCounts;     // the number of servers of every root
+    Worker** workers;
+    std::thread* threads;
+    int thresholds[PROBE_THRESHOLDS];
+    int* probes;                        // the answers of the workers to a global query, PROBE_THRESHOLDS pairs each
+    std::atomic<int>* probesDone;
+
+    int Owner(int root) const;
+    EngineResult Error() const;         // of any worker
+    EngineResult Probe(TaskOp op, int arg1, int arg2);  // posts to every worker and waits for all of them
+    EngineResult SumHighestTrafficServers(int k, int* traffic);     // over every data center
+    static void Wait(std::atomic<int>& done);
+};
+
+#endif //DATACENTERS_WET2_PARTITIONEDENGINE_H
@@ -8,11 +8,13 @@
 typedef int ServerID;
 typedef int DataCenterID;
 
+const int MAX_DATA_CENTERS = 1 << 30;   // AddDataCenter fails past it
+
 struct ServerKey {
     int traffic;
     ServerID serverId;
 
-    ServerKey(int traffic, ServerID serverId) : traffic(traffic), serverId(serverId) {}
+    explicit ServerKey(int traffic = 0, ServerID serverId = 0) : traffic(traffic), serverId(serverId) {}
     bool operator<(const ServerKey& other) const {
         // if same traffic compare by IDs
         if (traffic == other.traffic)
@@ -31,8 +33,10 @@ struct Server {
     ServerID serverID;
     DataCenterID dataCenterID;
     int traffic;
+    int treeNode;   // the server's node in an AVL traffic tree, -1 if it isn't in one
+    int pending;    // the server's entry in its manager's write buffer, -1 if it has none
 
-    explicit Server(ServerID id = 0, DataCenterID dataCenterId = 0) : serverID(id), dataCenterID(dataCenterId), traffic(0) {}
+    explicit Server(ServerID id = 0, DataCenterID dataCenterId = 0) : serverID(id), dataCenterID(dataCenterId), traffic(0), treeNode(-1), pending(-1) {}
     Server(const Server& other) = default;
     Server& operator=(const Server& other) = default;
 };
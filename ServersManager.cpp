@@ -1,4 +1,6 @@
+#include <utility>
 #include "ServersManager.h"
+#include "MergeSort.h"
 
 
 ServersManagerResult ServersManager::AddServer(DataCenterID dataCenterID, ServerID serverID) {
@@ -13,12 +15,9 @@ ServersManagerResult ServersManager::AddServer(DataCenterID dataCenterID, Server
 ServersManagerResult ServersManager::RemoveServer(ServerID serverID) {
     if (!servers.Contains(serverID)) return SM_FAILURE; // server doesn't exist
 
-    Server server = servers.Find(serverID);
-    int traffic = server.traffic;
-    ServerKey key(traffic, serverID);
-    trafficTree.remove(key);  // remove the server from the traffic tree
-                                        // if traffic = 0 the server is not in the tree
-                                        // and nothing happens
+    Server& server = servers.Find(serverID);
+    if (server.pending != -1) writeBuffer.Drop(server.pending);
+    if (server.traffic != 0) RemoveKey(server);   // if traffic = 0 the server is not in the tree
 
     servers.Delete(serverID);  // delete from servers hash table
 
@@ -29,22 +28,373 @@ ServersManagerResult ServersManager::SetTraffic(ServerID serverID, int traffic)
     if (!servers.Contains(serverID)) return SM_FAILURE; // server doesn't exist
 
     Server& server = servers.Find(serverID);
-    ServerKey key(server.traffic, serverID);
+    if (writeBuffer.Capacity() > 0) {
+        if (server.pending != -1) {
+            writeBuffer.Set(server.pending, traffic);   // only the last one is applied
+            return SM_SUCCESS;
+        }
+        if (writeBuffer.IsFull()) Flush();
+        server.pending = writeBuffer.Add(ServerKey(traffic, serverID));
+        return SM_SUCCESS;
+    }
 
-    if (server.traffic != 0)        // if the server is in the tree
-        trafficTree.remove(key);    // remove it
+    UpdateTraffic(server, traffic);
+    return SM_SUCCESS;
+}
 
-    server.traffic = traffic;       // change the server's traffic in the hash table
+ServersManagerResult ServersManager::MoveServer(ServerID serverID, DataCenterID dataCenterID,
+                                                ServersManager& destination) {
+    if (!servers.Contains(serverID)) return SM_FAILURE; // server doesn't exist
+
+    if (&destination == this) {
+        servers.Find(serverID).dataCenterID = dataCenterID;     // its key doesn't change
+        return SM_SUCCESS;
+    }
+    if (destination.servers.Contains(serverID)) return SM_FAILURE;
+    if (servers.Find(serverID).pending != -1) Flush();  // its key is the one to move
 
-    key.traffic = traffic;
-    if (traffic != 0)                       // if the given traffic is zero we dont add it to the tree
-        trafficTree.insert(key, server);    // insert the server in the tree
+    // into the destination first, so nothing changes here if it runs out of memory. the removal from here can't
+    // run out of memory after that: the tree is thawed and the array it may be demoted to is reserved beforehand
+    Server& server = servers.Find(serverID);
+    if (server.traffic != 0 && rankTree != RANK_HISTOGRAM) {
+        if (frozen) Thaw();
+        if (!small && TrafficServersNum() <= SMALL_RANK_MIN) smallTree.Reserve(SMALL_RANK_MIN);
+    }
+    Server moved(serverID, dataCenterID);
+    moved.traffic = server.traffic;
+    destination.servers.Insert(serverID, moved);
+    if (moved.traffic != 0) {
+        try {
+            destination.InsertKey(destination.servers.Find(serverID));
+        } catch (std::bad_alloc& ba) {
+            destination.servers.Delete(serverID);
+            throw;
+        }
+    }
 
+    if (server.traffic != 0) RemoveKey(server);
+    servers.Delete(serverID);
     return SM_SUCCESS;
 }
 
-int ServersManager::SumHighestTrafficServers(int k) {
-    return trafficTree.SumHighestTrafficServers(k);
+void ServersManager::UpdateTraffic(Server& server, int traffic) {
+    ServerID serverID = server.serverID;
+    if (!small && rankTree == RANK_TREE_AVL && server.traffic != 0 && traffic != 0) {
+        // go straight to the server's node (every server in the tree has its handle)
+        version++;
+        if (topLimit > 0) {
+            RemoveTop(ServerKey(server.traffic, serverID));
+            InsertTop(ServerKey(traffic, serverID));
+        }
+        trafficTree.update(server.treeNode, ServerKey(traffic, serverID), &server.treeNode);
+        server.traffic = traffic;
+        return;
+    }
+
+    if (server.traffic != 0) RemoveKey(server);    // if the server is in the tree, remove it
+    server.traffic = traffic;       // change the server's traffic in the hash table
+    if (traffic == 0) return;       // if the given traffic is zero we dont add it to the tree
+    try {
+        InsertKey(server);
+    } catch (std::bad_alloc& ba) {
+        server.traffic = 0;     // its old key is gone, so it's left without traffic
+        throw;
+    }
+}
+
+void ServersManager::SetTraffics(const ServerID* serverIDs, const int* traffics, int count) {
+    Flush();    // a recorded traffic of one of them would be applied after this one
+    ApplyTraffics(serverIDs, traffics, count);
+}
+
+void ServersManager::BufferWrites(int capacity) {
+    Flush();
+    writeBuffer.SetCapacity(capacity);
+}
+
+void ServersManager::Flush() {
+    int count = writeBuffer.Size();
+    if (count == 0) return;
+
+    // the entries of the servers that are still here, in (traffic, id) order so the tree is updated from left to right
+    ServerKey* entries = nullptr, * helper = nullptr;
+    ServerID* serverIDs = nullptr;
+    int* traffics = nullptr;
+    try {
+        entries = new ServerKey[count];
+        helper = new ServerKey[count];
+        serverIDs = new ServerID[count];
+        traffics = new int[count];
+    } catch (std::bad_alloc& ba) {
+        delete[] entries;
+        delete[] helper;
+        delete[] serverIDs;
+        throw;
+    }
+    int entriesNum = 0;
+    for (int i = 0; i < count; i++) {
+        if (writeBuffer.Entries()[i].serverId != 0) entries[entriesNum++] = writeBuffer.Entries()[i];
+    }
+    MergeSort(entries, helper, entriesNum);
+    for (int i = 0; i < entriesNum; i++) {
+        serverIDs[i] = entries[i].serverId;
+        traffics[i] = entries[i].traffic;
+    }
+
+    try {
+        ApplyTraffics(serverIDs, traffics, entriesNum);    // applying them again is harmless if it fails
+    } catch (std::bad_alloc& ba) {
+        delete[] entries;
+        delete[] helper;
+        delete[] serverIDs;
+        delete[] traffics;
+        throw;
+    }
+    for (int i = 0; i < entriesNum; i++) servers.Find(serverIDs[i]).pending = -1;
+    writeBuffer.Clear();
+    delete[] entries;
+    delete[] helper;
+    delete[] serverIDs;
+    delete[] traffics;
+}
+
+void ServersManager::ApplyTraffics(const ServerID* serverIDs, const int* traffics, int count) {
+    int keysNum = TrafficServersNum();
+    if (small || rankTree == RANK_HISTOGRAM || count * BATCH_REBUILD_RATIO < keysNum) {
+        for (int i = 0; i < count; i++) UpdateTraffic(servers.Find(serverIDs[i]), traffics[i]);
+        return;
+    }
+
+    // everything is allocated and built before anything changes
+    ServerKey* oldKeys = nullptr, * newKeys = nullptr, * helper = nullptr, * sorted = nullptr;
+    int sortedNum = 0;
+    TrafficTree tree;
+    BPlusTree bTree;
+    try {
+        oldKeys = new ServerKey[count];
+        newKeys = new ServerKey[count];
+        helper = new ServerKey[count];
+        sorted = new ServerKey[keysNum + count];
+
+        // the keys that leave and the keys that come, sorted
+        int oldNum = 0, newNum = 0;
+        for (int i = 0; i < count; i++) {
+            int traffic = servers.Find(serverIDs[i]).traffic;
+            if (traffic != 0) oldKeys[oldNum++] = ServerKey(traffic, serverIDs[i]);
+            if (traffics[i] != 0) newKeys[newNum++] = ServerKey(traffics[i], serverIDs[i]);
+        }
+        MergeSort(oldKeys, helper, oldNum);
+        MergeSort(newKeys, helper, newNum);
+
+        // one inorder walk: the old keys are skipped and the new ones merged in
+        int nextOld = 0, nextNew = 0;
+        ForEachByTraffic([&](const ServerKey& key) {
+            if (nextOld < oldNum && !(key != oldKeys[nextOld])) {
+                nextOld++;
+                return;
+            }
+            while (nextNew < newNum && newKeys[nextNew] < key) sorted[sortedNum++] = newKeys[nextNew++];
+            sorted[sortedNum++] = key;
+        });
+        while (nextNew < newNum) sorted[sortedNum++] = newKeys[nextNew++];
+
+        if (sortedNum >= SMALL_RANK_MIN) {
+            if (rankTree == RANK_TREE_BPLUS) bTree = BPlusTree::BuildFromSorted(sorted, sortedNum);
+            else tree = TrafficTree::BuildFromSorted(sorted, sortedNum);
+        }
+    } catch (std::bad_alloc& ba) {
+        delete[] oldKeys;
+        delete[] newKeys;
+        delete[] helper;
+        delete[] sorted;
+        throw;
+    }
+    delete[] oldKeys;
+    delete[] newKeys;
+    delete[] helper;
+
+    if (sortedNum < SMALL_RANK_MIN) {
+        // the tree would shrink back to the array, one by one is as good
+        delete[] sorted;
+        for (int i = 0; i < count; i++) UpdateTraffic(servers.Find(serverIDs[i]), traffics[i]);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        Server& server = servers.Find(serverIDs[i]);
+        server.traffic = traffics[i];
+        server.treeNode = NULL_NODE;    // the servers in the new tree get their handles below
+    }
+    version++;
+    if (rankTree == RANK_TREE_BPLUS) {
+        trafficBTree = std::move(bTree);
+    } else {
+        trafficTree = std::move(tree);
+        SetHandles();
+    }
+
+    // the highest keys are at the end of the sorted keys, the top has room for them
+    if (topLimit > 0) {
+        int topNum = sortedNum < topLimit ? sortedNum : topLimit;
+        top.Assign(sorted + sortedNum - topNum, topNum);
+    }
+    delete[] sorted;
+}
+
+int ServersManager::SumHighestTrafficServers(int k) const {
+    if (k <= 0) return 0;
+    if (topLimit > 0 && (k <= topLimit || top.Size() < topLimit)) return top.SumHighestTrafficServers(k);
+
+    CachedSum& cached = cache[k % QUERY_CACHE_SIZE];
+    if (cached.k == k && cached.version == version) return cached.sum;
+
+    int sum;
+    if (rankTree == RANK_HISTOGRAM) sum = histogram.SumHighestTrafficServers(k);
+    else if (small) sum = smallTree.SumHighestTrafficServers(k);
+    else if (rankTree == RANK_TREE_BPLUS) sum = trafficBTree.SumHighestTrafficServers(k);
+    else sum = trafficTree.HighestAggregate(k);
+    cached.k = k;
+    cached.sum = sum;
+    cached.version = version;
+    return sum;
+}
+
+void ServersManager::SumHighestTrafficServers(const int* ks, int count, int* sums) const {
+    if (!small && rankTree == RANK_TREE_AVL) {
+        trafficTree.HighestAggregates(ks, count, sums);
+        return;
+    }
+
+    // a prefix sum lookup, a short descent of a wide tree or a scan of the histogram, each
+    for (int i = 0; i < count; i++) sums[i] = SumHighestTrafficServers(ks[i]);
+}
+
+int ServersManager::SumHighestTrafficServers(const ServersManager* const* managers, int managersNum, int k) {
+    if (k <= 0) return 0;
+
+    int total = 0, maxTraffic = 0;
+    for (int i = 0; i < managersNum; i++) {
+        int highest;
+        total += managers[i]->TrafficServersNum();
+        if (managers[i]->HighestTraffics(1, &highest) == 1 && highest > maxTraffic) maxTraffic = highest;
+    }
+
+    int count, sum;
+    if (k >= total) {
+        TotalTrafficAtLeast(managers, managersNum, 1, &count, &sum);
+        return sum;
+    }
+
+    // the k highest traffics are every traffic above some threshold and some of the servers at it.
+    // binary search the highest threshold with at least k servers at or above it
+    int low = 1, high = maxTraffic;
+    while (low < high) {
+        int middle = low + (high - low + 1) / 2;
+        TotalTrafficAtLeast(managers, managersNum, middle, &count, &sum);
+        if (count >= k) low = middle;
+        else high = middle - 1;
+    }
+
+    // the servers above the threshold, and the rest from the servers at it
+    if (low == maxTraffic) count = sum = 0;
+    else TotalTrafficAtLeast(managers, managersNum, low + 1, &count, &sum);
+    return sum + (k - count) * low;
+}
+
+void ServersManager::TrafficAtLeast(int traffic, int* count, int* sum) const {
+    if (small) smallTree.TrafficAtLeast(traffic, count, sum);
+    else if (rankTree == RANK_TREE_BPLUS) trafficBTree.TrafficAtLeast(traffic, count, sum);
+    else *sum = trafficTree.AggregateAtLeast(ServerKey(traffic, 0), count);    // below every key with this traffic
+}
+
+void ServersManager::Freeze() {
+    if (rankTree == RANK_HISTOGRAM) return;     // no keys to move
+    Flush();
+    frozen = true;
+    if (small) return;
+
+    // a top-k sum on the array is a subtraction of two prefix sums
+    int count = TrafficServersNum(), i = 0;
+    auto keys = new ServerKey[count];
+    ForEachByTraffic([&](const ServerKey& key) { keys[i++] = key; });
+    try {
+        smallTree.Assign(keys, count);
+    } catch (std::bad_alloc& ba) {
+        frozen = false;
+        delete[] keys;
+        throw;
+    }
+    delete[] keys;
+    ClearTree();
+}
+
+int ServersManager::TrafficByRank(int rank) const {
+    if (rank > TrafficServersNum()) return 0;   // one of the servers without traffic
+    return SelectHighest(rank).traffic;
+}
+
+int ServersManager::CountAbove(int traffic, int* sum) const {
+    int count;
+    if (traffic == INT_MAX) count = *sum = 0;
+    else TrafficAtLeast(traffic + 1, &count, sum);
+    return count;
+}
+
+int ServersManager::CountBelow(int traffic, int* sum) const {
+    if (traffic <= 0) return *sum = 0;     // no server has less than 0
+
+    // everything but the servers with at least this traffic
+    int count, atLeastCount, atLeastSum;
+    TrafficAtLeast(1, &count, sum);
+    TrafficAtLeast(traffic, &atLeastCount, &atLeastSum);
+    *sum -= atLeastSum;
+    return ServersNum() - atLeastCount;
+}
+
+int ServersManager::Percentile(int percentile) const {
+    // the ceil(percentile% of n)-th lowest server (at least the first), which is the (n - that + 1)-th highest
+    int serversNum = ServersNum();
+    int lowRank = (int)(((long)percentile * serversNum + 99) / 100);
+    if (lowRank < 1) lowRank = 1;
+    return TrafficByRank(serversNum - lowRank + 1);
+}
+
+int ServersManager::TrafficServersNum() const {
+    if (rankTree == RANK_HISTOGRAM) return histogram.Size();
+    if (small) return smallTree.Size();
+    return (rankTree == RANK_TREE_BPLUS) ? trafficBTree.Size() : trafficTree.Size();
+}
+
+int ServersManager::HighestTraffics(int k, int* traffics) const {
+    if (small) return smallTree.HighestTraffics(k, traffics);
+    if (rankTree == RANK_TREE_BPLUS) return trafficBTree.HighestTraffics(k, traffics);
+    if (k <= 0) return 0;
+
+    // backward inorder from the highest traffic
+    int count = 0;
+    trafficTree.ForEachDown(nullptr, [&](const ServerKey& key) {
+        traffics[count++] = key.traffic;
+        return count < k;
+    });
+    return count;
+}
+
+int ServersManager::ListHighest(int k, ServerID* serverIDs, int* traffics) const {
+    return ListRange(1, INT_MAX, k, serverIDs, traffics);
+}
+
+int ServersManager::ListRange(int low, int high, int maxCount, ServerID* serverIDs, int* traffics) const {
+    if (low < 1) low = 1;   // servers without traffic aren't listed
+    if (maxCount <= 0 || low > high) return 0;
+
+    int count = 0;
+    ForEachDown(high, [&](const ServerKey& key) {
+        if (key.traffic < low) return false;
+        serverIDs[count] = key.serverId;
+        traffics[count++] = key.traffic;
+        return count < maxCount;
+    });
+    return count;
 }
 
 DataCenterID ServersManager::GetDataCenterID(ServerID serverID) {
@@ -53,8 +403,209 @@ DataCenterID ServersManager::GetDataCenterID(ServerID serverID) {
 }
 
 ServersManager ServersManager::MergeServers(const ServersManager& a, const ServersManager& b) {
-    ServersManager manager;
+    ServersManager manager(a.rankTree);     // the merged manager keeps a's engine
     manager.servers = HashTable<Server>::Merge(a.servers, b.servers);           // merge hash tables
-    manager.trafficTree = AVL::MergeRankTrees(a.trafficTree, b.trafficTree);    // merge traffic trees
+
+    if (!a.small && !b.small && a.rankTree == b.rankTree) {
+        // two trees of the same engine
+        manager.small = false;
+        if (a.rankTree == RANK_TREE_BPLUS) {
+            manager.trafficBTree = BPlusTree::MergeRankTrees(a.trafficBTree, b.trafficBTree);
+        } else {
+            manager.trafficTree = TrafficTree::MergeRankTrees(a.trafficTree, b.trafficTree);    // merge traffic trees
+            manager.SetHandles();   // the servers' nodes moved in the merged tree
+        }
+    } else {
+        // merge the sorted keys of both sides, and build what fits the merged size
+        int aCount = a.TrafficServersNum(), bCount = b.TrafficServersNum();
+        auto sorted = new ServerKey[aCount + bCount + 1];
+        auto bKeys = sorted + aCount;   // b's keys go after a's, then both are merged into a temporary
+        int i = 0;
+        a.ForEachByTraffic([&](const ServerKey& key) { sorted[i++] = key; });
+        b.ForEachByTraffic([&](const ServerKey& key) { sorted[i++] = key; });
+
+        ServerKey* merged = nullptr;
+        try {
+            merged = new ServerKey[aCount + bCount + 1];
+            int x = 0, y = 0, z = 0;
+            while (x < aCount && y < bCount) merged[z++] = (sorted[x] < bKeys[y]) ? sorted[x++] : bKeys[y++];
+            while (x < aCount) merged[z++] = sorted[x++];
+            while (y < bCount) merged[z++] = bKeys[y++];
+            manager.SetKeys(merged, aCount + bCount);
+        } catch (std::bad_alloc& ba) {
+            delete[] merged;
+            delete[] sorted;
+            throw;
+        }
+        delete[] merged;
+        delete[] sorted;
+    }
+
+    // whichever way it was built, it keeps the bigger top prefix and write buffer of the two
+    manager.KeepTopPrefix(a.topLimit > b.topLimit ? a.topLimit : b.topLimit);
+    int capacity = a.writeBuffer.Capacity(), bCapacity = b.writeBuffer.Capacity();
+    manager.BufferWrites(capacity > bCapacity ? capacity : bCapacity);
     return manager; // return the merged ServersManager
 }
+
+void ServersManager::KeepTopPrefix(int limit) {
+    if (rankTree == RANK_HISTOGRAM) return;     // no keys to keep
+    Flush();
+    if (limit == 0) {
+        top.Clear();
+        topLimit = 0;
+        return;
+    }
+
+    // the highest keys, ascending. the array has room for limit, so the updates never allocate
+    int count = TrafficServersNum() < limit ? TrafficServersNum() : limit;
+    auto keys = new ServerKey[count + 1];
+    int i = count;
+    if (count > 0) ForEachDown(INT_MAX, [&](const ServerKey& key) { keys[--i] = key; return i > 0; });
+    try {
+        top.Clear();
+        top.Reserve(limit);
+        top.Assign(keys, count);
+    } catch (std::bad_alloc& ba) {
+        topLimit = 0;
+        delete[] keys;
+        throw;
+    }
+    delete[] keys;
+    topLimit = limit;
+}
+
+//--------------------------- PRIVATE FUNCTIONS -----------------------
+
+void ServersManager::InsertKey(Server& server) {
+    ServerKey key(server.traffic, server.serverID);
+    version++;
+    if (rankTree == RANK_HISTOGRAM) {
+        histogram.Add(server.traffic);
+        return;
+    }
+    if (frozen) Thaw();
+    if (small && smallTree.Size() < SMALL_RANK_MAX) {
+        smallTree.insert(key);
+    } else {
+        if (small) Promote();   // too big for the array
+        if (rankTree == RANK_TREE_BPLUS) trafficBTree.insert(key);
+        else if (trafficTree.insert(key, &server.treeNode) == AVL_FAILURE) throw std::bad_alloc();  // no room in subTreeSize
+    }
+    if (topLimit > 0) InsertTop(key);   // once the key is in, the top never allocates
+}
+
+void ServersManager::RemoveKey(Server& server) {
+    ServerKey key(server.traffic, server.serverID);
+    version++;
+    if (rankTree == RANK_HISTOGRAM) {
+        histogram.Remove(server.traffic);
+        return;
+    }
+    if (topLimit > 0) RemoveTop(key);
+    if (frozen) Thaw();
+    if (small) {
+        smallTree.remove(key);
+        return;
+    }
+
+    if (rankTree == RANK_TREE_BPLUS) {
+        trafficBTree.remove(key);
+    } else {
+        trafficTree.removeAt(server.treeNode);
+        server.treeNode = NULL_NODE;
+    }
+    if (TrafficServersNum() < SMALL_RANK_MIN) Demote();
+}
+
+void ServersManager::SetKeys(const ServerKey* sorted, int count) {
+    // only called on a new manager
+    if (count <= SMALL_RANK_MAX) {
+        smallTree.Assign(sorted, count);
+        return;
+    }
+
+    small = false;
+    if (rankTree == RANK_TREE_BPLUS) {
+        trafficBTree = BPlusTree::BuildFromSorted(sorted, count);
+    } else {
+        trafficTree = TrafficTree::BuildFromSorted(sorted, count);
+        SetHandles();
+    }
+}
+
+void ServersManager::Promote() {
+    // the tree is built at once from the sorted array
+    if (rankTree == RANK_TREE_BPLUS) {
+        trafficBTree = BPlusTree::BuildFromSorted(smallTree.Keys(), smallTree.Size());
+    } else {
+        trafficTree = TrafficTree::BuildFromSorted(smallTree.Keys(), smallTree.Size());
+        SetHandles();
+    }
+    smallTree.Clear();
+    small = false;
+}
+
+void ServersManager::Demote() {
+    ServerKey keys[SMALL_RANK_MIN];
+    int count = 0;
+    ForEachByTraffic([&](const ServerKey& key) { keys[count++] = key; });
+    smallTree.Assign(keys, count);
+    ClearTree();
+}
+
+void ServersManager::ClearTree() {
+    if (rankTree == RANK_TREE_BPLUS) {
+        trafficBTree = BPlusTree();
+    } else {
+        trafficTree = TrafficTree();
+        smallTree.ForEach([this](const ServerKey& key) { servers.Find(key.serverId).treeNode = NULL_NODE; });
+    }
+    small = true;
+}
+
+void ServersManager::Thaw() {
+    // back to the tree, built at once from the sorted array
+    if (smallTree.Size() > SMALL_RANK_MAX) Promote();
+    frozen = false;
+}
+
+void ServersManager::TotalTrafficAtLeast(const ServersManager* const* managers, int managersNum, int traffic,
+                                         int* count, int* sum) {
+    *count = *sum = 0;
+    for (int i = 0; i < managersNum; i++) {
+        int managerCount, managerSum;
+        managers[i]->TrafficAtLeast(traffic, &managerCount, &managerSum);
+        *count += managerCount;
+        *sum += managerSum;
+    }
+}
+
+ServerKey ServersManager::SelectHighest(int rank) const {
+    if (small) return smallTree.SelectHighest(rank);
+    if (rankTree == RANK_TREE_BPLUS) return trafficBTree.SelectHighest(rank);
+    return trafficTree.SelectHighest(rank);
+}
+
+void ServersManager::InsertTop(const ServerKey& key) {
+    if (top.Size() == topLimit) {
+        ServerKey lowest = top.SelectHighest(topLimit);
+        if (key < lowest) return;   // not one of the highest
+        top.remove(lowest);
+    }
+    top.insert(key);
+}
+
+void ServersManager::RemoveTop(const ServerKey& key) {
+    if (top.Size() == 0 || key < top.SelectHighest(top.Size())) return;     // not one of the highest
+
+    // the highest key that wasn't kept takes its place
+    top.remove(key);
+    if (TrafficServersNum() > topLimit) top.insert(SelectHighest(topLimit + 1));
+}
+
+void ServersManager::SetHandles() {
+    for (auto iter = trafficTree.begin(); !iter.isEnd(); iter++) {
+        servers.Find((*iter).serverId).treeNode = iter.curr;
+    }
+}
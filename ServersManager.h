@@ -1,8 +1,21 @@
 #ifndef DATACENTERS_WET2_SERVERSMANAGER_H
 #define DATACENTERS_WET2_SERVERSMANAGER_H
 
+#include <climits>
 #include "HashTable.h"
 #include "AVL.h"
+#include "AggregatePolicies.h"
+#include "BPlusTree.h"
+#include "FlatRankArray.h"
+#include "TrafficHistogram.h"
+#include "WriteBuffer.h"
+
+const int SMALL_RANK_MAX = 64;  // more servers with traffic than this move from the flat array to the tree
+const int SMALL_RANK_MIN = 32;  // less than this move back
+const int QUERY_CACHE_SIZE = 8; // top-k sums remembered by a manager, by k
+const int TOP_PREFIX_MAX = 256; // the most highest keys a manager can keep apart (see KeepTopPrefix)
+const int WRITE_BUFFER_MAX = 1 << 16;   // the most traffics a manager can hold back (see BufferWrites)
+const int BATCH_REBUILD_RATIO = 5;  // a batch of more than 1/5 of the keys rebuilds the rank tree (see SetTraffics)
 
 enum ServersManagerResult {
     SM_SUCCESS = 0,
@@ -11,10 +24,23 @@ enum ServersManagerResult {
     SM_INVALID_INPUT = -3
 };
 
+// the AVL engine's tree only keeps the traffic sums its queries need
+typedef AugmentedAVL<ServerKey, TrafficSum> TrafficTree;
+static_assert(sizeof(TrafficTree::Node) < 32, "a tree node should fit in less than 32 bytes");
+
+// which rank tree keeps the servers ordered by traffic
+enum RankTreeEngine {
+    RANK_TREE_AVL,
+    RANK_TREE_BPLUS,
+    RANK_HISTOGRAM      // approximate: no keys, only the top-k sums and the counts are answered
+};
+
 class ServersManager {
 public:
 
-    ServersManager() = default;
+    explicit ServersManager(RankTreeEngine rankTree = RANK_TREE_AVL) :
+            servers(), rankTree(rankTree), small(true), frozen(false), smallTree(), trafficTree(), trafficBTree(),
+            version(0), cache(), topLimit(0), top(), histogram(), writeBuffer() {}
     ~ServersManager() = default;
     ServersManager(const ServersManager& other) = default;
     ServersManager& operator=(const ServersManager& other) = default;
@@ -22,12 +48,113 @@ public:
     ServersManagerResult AddServer(DataCenterID dataCenterID, ServerID serverID);
     ServersManagerResult RemoveServer(ServerID serverID);
     ServersManagerResult SetTraffic(ServerID serverID, int traffic);
-    int SumHighestTrafficServers(int k);
+    // moves the server, with its traffic, to destination as a server of dataCenterID. if destination is this
+    // manager, only the server's data center changes. FAILURE if destination has it already
+    ServersManagerResult MoveServer(ServerID serverID, DataCenterID dataCenterID, ServersManager& destination);
+    // sets the traffic of distinct existing servers. a big batch is merged into the sorted keys and the tree is
+    // built again at once, instead of a removal and an insertion per server
+    void SetTraffics(const ServerID* serverIDs, const int* traffics, int count);
+    // SetTraffic only records the traffic, up to capacity servers, and a server set again only overwrites it.
+    // the queries below answer from the applied traffics: Flush applies the recorded ones, as one batch sorted by
+    // traffic. it's called by SetTraffic when the buffer is full. 0 <= capacity <= WRITE_BUFFER_MAX, 0 stops
+    void BufferWrites(int capacity);
+    void Flush();
+    bool HasPendingWrites() const { return writeBuffer.Size() > 0; }
+    int SumHighestTrafficServers(int k) const;     // repeated while nothing changes, it's answered from a cache
+    static int SumHighestTrafficServers(const ServersManager* const* managers, int managersNum, int k);  // over all of them
+    void SumHighestTrafficServers(const int* ks, int count, int* sums) const;   // for every k in ks (ascending)
+    void TrafficAtLeast(int traffic, int* count, int* sum) const;   // the servers with at least this traffic
     DataCenterID GetDataCenterID(ServerID serverID);
+    // both flushed. only the manager of all the servers is approximate, and it's never merged
     static ServersManager MergeServers(const ServersManager& a, const ServersManager& b);
+    int TrafficServersNum() const;     // servers with non-zero traffic
+    int ServersNum() const { return servers.Size(); }
+
+    // order statistics over all the servers, the ones without traffic count as traffic 0
+    int TrafficByRank(int rank) const;      // the traffic of the rank-th highest server, 1 <= rank <= ServersNum()
+    int CountAbove(int traffic, int* sum) const;    // servers with more than this traffic, and their total traffic
+    int CountBelow(int traffic, int* sum) const;    // servers with less than this traffic, and their total traffic
+    int Percentile(int percentile) const;   // nearest rank: the lowest traffic that at least percentile% of the servers
+                                            // don't exceed. 0 <= percentile <= 100, ServersNum() > 0
+    void Freeze();      // moves the keys to the sorted array until the next change of traffic
+    // keeps the limit highest keys apart, with their prefix sums, so a top-k sum with k <= limit is a subtraction.
+    // every change of traffic updates them. 0 <= limit <= TOP_PREFIX_MAX, 0 stops
+    void KeepTopPrefix(int limit);
+    bool IsFrozen() const { return frozen; }
+    bool IsApproximate() const { return rankTree == RANK_HISTOGRAM; }
+    int HighestTraffics(int k, int* traffics) const;   // the k highest traffics, descending. returns how many
+    // the servers with traffic, in descending (traffic, id) order, written to the caller's arrays. return how many
+    int ListHighest(int k, ServerID* serverIDs, int* traffics) const;  // the first k
+    int ListRange(int low, int high, int maxCount, ServerID* serverIDs, int* traffics) const;  // low <= traffic <= high
+    template<class Function>
+    void ForEachByTraffic(Function function) const;    // ascending (traffic, id) order
+    template<class Function>
+    void ForEachServer(Function function) const { servers.ForEach([&](int, const Server& server) { function(server); }); }
+    template<class Function>
+    void ForEachDown(int highTraffic, Function function) const;  // descending from highTraffic, while function is true
 
 private:
     HashTable<Server> servers;
-    AVL trafficTree;
+    RankTreeEngine rankTree;
+    bool small;             // while there are few servers with traffic, they are in smallTree and not in a tree
+    bool frozen;            // small whatever the number of servers with traffic. thawed by the next change
+    FlatRankArray smallTree;
+    TrafficTree trafficTree;    // only the tree of the engine in use has servers
+    BPlusTree trafficBTree;
+
+    // a top-k sum is valid while version is the same. every change of the keys changes version
+    struct CachedSum {
+        CachedSum() : k(-1), sum(0), version(0) {}
+
+        int k;
+        int sum;
+        unsigned long long version;
+    };
+    unsigned long long version;
+    mutable CachedSum cache[QUERY_CACHE_SIZE];    // by k modulo the size
+    int topLimit;       // 0 if the top prefix isn't kept
+    FlatRankArray top;  // the topLimit highest keys (all of them if there are less)
+    TrafficHistogram histogram;     // only with RANK_HISTOGRAM, instead of the keys
+    WriteBuffer writeBuffer;    // no capacity if the writes aren't buffered
+
+    void UpdateTraffic(Server& server, int traffic);    // applies it
+    void ApplyTraffics(const ServerID* serverIDs, const int* traffics, int count);
+    void InsertKey(Server& server);
+    void RemoveKey(Server& server);
+    void SetKeys(const ServerKey* sorted, int count);   // replaces all the keys
+    void Promote();
+    void Demote();
+    void ClearTree();   // after its keys were moved to the array
+    void Thaw();
+    void SetHandles();
+    ServerKey SelectHighest(int rank) const;    // 1 <= rank <= TrafficServersNum()
+    void InsertTop(const ServerKey& key);
+    void RemoveTop(const ServerKey& key);       // before the key leaves the rank tree
+    static void TotalTrafficAtLeast(const ServersManager* const* managers, int managersNum, int traffic, int* count, int* sum);
 };
+
+template<class Function>
+void ServersManager::ForEachByTraffic(Function function) const {
+    if (small) {
+        smallTree.ForEach(function);
+        return;
+    }
+    if (rankTree == RANK_TREE_BPLUS) {
+        trafficBTree.ForEach(function);
+        return;
+    }
+
+    // inorder on the traffic tree
+    for (auto iter = trafficTree.begin(); iter != trafficTree.end(); iter++) {
+        function(*iter);
+    }
+}
+
+template<class Function>
+void ServersManager::ForEachDown(int highTraffic, Function function) const {
+    ServerKey upper(highTraffic, INT_MAX);  // above every key with this traffic
+    if (small) smallTree.ForEachDown(&upper, function);
+    else if (rankTree == RANK_TREE_BPLUS) trafficBTree.ForEachDown(&upper, function);
+    else trafficTree.ForEachDown(&upper, function);
+}
 #endif //DATACENTERS_WET2_SERVERSMANAGER_H
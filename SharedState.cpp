@@ -0,0 +1,249 @@
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "SharedState.h"
+
+const int SHARED_STATE_GROW_FACTOR = 2;     // how much spare room a new segment gets
+const int SHARED_STATE_MAX_RETRIES = 1100;  // how many times a reader retries a query that raced a publish
+const int SHARED_STATE_SPINS = 16;          // retries before a reader starts yielding
+const int SHARED_STATE_YIELDS = 64;         // retries before it starts sleeping
+const long SHARED_STATE_MAX_SLEEP = 1000000;    // the longest sleep between retries, in nanoseconds
+
+//--------------------------- OWNER FUNCTIONS -----------------------
+
+SharedState::SharedState(const char* name, bool owner) :
+        name(new char[strlen(name) + 1]), owner(owner),
+        fd(-1), segment(nullptr), segmentSize(0), builtNodes(0) {
+    strcpy(this->name, name);
+}
+
+SharedState::~SharedState() {
+    if (owner && segment) header()->retired = 1;  // tell the readers there will be no more publishes
+    Unmap();
+    if (owner) shm_unlink(name);
+    delete[] name;
+}
+
+SharedState* SharedState::Create(const char* name) {
+    auto state = new SharedState(name, true);
+    if (state->Map(RequiredSize(0, 0)) != SS_SUCCESS) {
+        delete state;
+        return nullptr;
+    }
+    return state;
+}
+
+SharedStateResult SharedState::BeginPublish(int dataCenterNum, int nodeCount) {
+    long required = RequiredSize(dataCenterNum, nodeCount);
+    if (required > segmentSize) {
+        // retire the current segment, readers that still map it will re-attach by name.
+        // there is none if growing it failed before
+        // the sequence is carried on, so readers don't take the new segment for one that was never published
+        int sequence = segment ? header()->sequence | 1 : 1;
+        if (segment) __atomic_store_n(&header()->retired, 1, __ATOMIC_RELEASE);
+        Unmap();
+        shm_unlink(name);
+        if (Map(required * SHARED_STATE_GROW_FACTOR, sequence) != SS_SUCCESS) return SS_FAILURE;
+    }
+
+    // odd sequence - readers must not trust what they read until it's even again.
+    // a new segment, or one whose last publish didn't end, is odd already
+    if (__atomic_load_n(&header()->sequence, __ATOMIC_RELAXED) % 2 == 0) {
+        __atomic_add_fetch(&header()->sequence, 1, __ATOMIC_ACQ_REL);
+    }
+
+    header()->dataCenterNum = dataCenterNum;
+    header()->nodeCount = nodeCount;
+    header()->globalTree = SHARED_NULL;
+    for (int i = 0; i < dataCenterNum; i++) trees()[i] = SHARED_NULL;
+    builtNodes = 0;
+
+    return SS_SUCCESS;
+}
+
+void SharedState::SetRoot(int dataCenterIdx, int rootIdx) {
+    roots()[dataCenterIdx] = rootIdx;
+}
+
+int SharedState::BuildTree(const ServerKey* sorted, int count) {
+    return BuildTreeHelp(sorted, 0, count - 1);
+}
+
+void SharedState::SetTree(int rootIdx, int node) {
+    trees()[rootIdx] = node;
+}
+
+void SharedState::SetGlobalTree(int node) {
+    header()->globalTree = node;
+}
+
+void SharedState::EndPublish() {
+    __atomic_add_fetch(&header()->sequence, 1, __ATOMIC_ACQ_REL);
+}
+
+//--------------------------- READER FUNCTIONS -----------------------
+
+SharedState* SharedState::Attach(const char* name) {
+    auto state = new SharedState(name, false);
+    if (state->Reattach() != SS_SUCCESS) {
+        delete state;
+        return nullptr;
+    }
+    return state;
+}
+
+SharedStateResult SharedState::SumHighestTrafficServers(DataCenterID dataCenterID, int k, int* traffic) {
+    long sleep = 1000;
+    for (int retry = 0; retry < SHARED_STATE_MAX_RETRIES; retry++) {
+        if (retry >= SHARED_STATE_YIELDS) {
+            // the publish takes a while, don't take the owner's CPU meanwhile
+            timespec delay = {0, sleep};
+            nanosleep(&delay, nullptr);
+            if (sleep < SHARED_STATE_MAX_SLEEP) sleep *= 2;
+        } else if (retry >= SHARED_STATE_SPINS) {
+            sched_yield();
+        }
+
+        if (!segment || __atomic_load_n(&header()->retired, __ATOMIC_ACQUIRE)) {
+            // the owner moved to a new segment (or quit)
+            if (Reattach() != SS_SUCCESS) return SS_FAILURE;
+        }
+
+        int sequence = __atomic_load_n(&header()->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == 1) return SS_FAILURE;   // nothing was published yet, there is nothing to wait for
+        if (sequence % 2 != 0) continue;    // a publish is in progress
+
+        // read the query straight from the mapping, trusting only sizes that fit in it
+        int dataCenterNum = header()->dataCenterNum, nodeCount = header()->nodeCount;
+        bool valid = (RequiredSize(dataCenterNum, nodeCount) <= segmentSize) && dataCenterID <= dataCenterNum;
+        auto rootArray = (const int*)(segment + sizeof(Header));
+        auto treeArray = rootArray + dataCenterNum;
+        auto nodeArray = (const Node*)(treeArray + dataCenterNum);
+
+        int tree = SHARED_NULL;
+        if (valid && dataCenterID == 0) {
+            tree = header()->globalTree;
+        } else if (valid) {
+            int root = rootArray[dataCenterID - 1];
+            valid = (root >= 0 && root < dataCenterNum);
+            if (valid) tree = treeArray[root];
+        }
+        valid = valid && SumHighestHelp(nodeArray, nodeCount, tree, k, traffic);
+
+        // accept the answer only if no publish happened meanwhile
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header()->sequence, __ATOMIC_RELAXED) == sequence) {
+            return valid ? SS_SUCCESS : SS_FAILURE;
+        }
+    }
+    return SS_BUSY;
+}
+
+//--------------------------- PRIVATE FUNCTIONS -----------------------
+
+SharedStateResult SharedState::Map(long size, int sequence) {
+    if (owner) {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) return SS_FAILURE;
+        if (ftruncate(fd, size) != 0) return SS_FAILURE;
+    } else {
+        fd = shm_open(name, O_RDONLY, 0);
+        if (fd == -1) return SS_FAILURE;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (long)sizeof(Header)) return SS_FAILURE;
+        size = info.st_size;
+    }
+
+    void* mapping = mmap(nullptr, size, owner ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) return SS_FAILURE;
+    segment = (char*)mapping;
+    segmentSize = size;
+
+    if (owner) {
+        // a fresh segment has no image yet: its sequence is odd until the publish ends, so a reader
+        // that attaches to it meanwhile retries (or fails, before the first publish) instead of reading an empty image
+        header()->magic = SHARED_STATE_MAGIC;
+        header()->sequence = sequence;
+        header()->retired = 0;
+        header()->dataCenterNum = 0;
+        header()->nodeCount = 0;
+        header()->globalTree = SHARED_NULL;
+        header()->segmentSize = size;
+    } else if (header()->magic != SHARED_STATE_MAGIC) {
+        return SS_FAILURE;
+    }
+
+    return SS_SUCCESS;
+}
+
+void SharedState::Unmap() {
+    if (segment) munmap(segment, segmentSize);
+    if (fd != -1) close(fd);
+    segment = nullptr;
+    segmentSize = 0;
+    fd = -1;
+}
+
+SharedStateResult SharedState::Reattach() {
+    Unmap();
+    return Map(0);
+}
+
+long SharedState::RequiredSize(int dataCenterNum, int nodeCount) {
+    return (long)sizeof(Header) + 2 * (long)dataCenterNum * (long)sizeof(int) + (long)nodeCount * (long)sizeof(Node);
+}
+
+int SharedState::BuildTreeHelp(const ServerKey* sorted, int first, int last) {
+    if (first > last) return SHARED_NULL;
+
+    // the middle element is the root, so the tree is balanced
+    int middle = first + (last - first) / 2;
+    int index = builtNodes++;
+    int left = BuildTreeHelp(sorted, first, middle - 1);
+    int right = BuildTreeHelp(sorted, middle + 1, last);
+
+    Node& node = nodes()[index];
+    node.traffic = sorted[middle].traffic;
+    node.serverID = sorted[middle].serverId;
+    node.left = left;
+    node.right = right;
+    node.subTreeSize = last - first + 1;
+    node.subTreeTraffic = node.traffic;
+    if (left != SHARED_NULL) node.subTreeTraffic += nodes()[left].subTreeTraffic;
+    if (right != SHARED_NULL) node.subTreeTraffic += nodes()[right].subTreeTraffic;
+
+    return index;
+}
+
+bool SharedState::SumHighestHelp(const Node* nodeArray, int nodeCount, int tree, int k, int* traffic) {
+    // same descent as AVL::SumHighestTrafficServers, following indices instead of pointers
+    int trafficSum = 0;
+    int curr = tree;
+
+    // the depth of a balanced tree is bounded, anything deeper means we raced a publish
+    for (int steps = 0; k > 0 && curr != SHARED_NULL; steps++) {
+        if (curr < 0 || curr >= nodeCount || steps > 64) return false;
+        const Node& node = nodeArray[curr];
+        int right = node.right;
+        if (right != SHARED_NULL && (right < 0 || right >= nodeCount)) return false;
+
+        if (right == SHARED_NULL) {
+            trafficSum += node.traffic;
+            k -= 1;
+            curr = node.left;
+        } else if (nodeArray[right].subTreeSize >= k) {
+            curr = right;
+        } else {
+            trafficSum += node.traffic + nodeArray[right].subTreeTraffic;
+            k -= nodeArray[right].subTreeSize + 1;
+            curr = node.left;
+        }
+    }
+
+    *traffic = trafficSum;
+    return true;
+}
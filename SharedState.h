@@ -0,0 +1,83 @@
+#ifndef DATACENTERS_WET2_SHAREDSTATE_H
+#define DATACENTERS_WET2_SHAREDSTATE_H
+
+#include "Server.h"
+
+const int SHARED_STATE_MAGIC = 0x53484D53;   // "SHMS"
+const int SHARED_NULL = -1;                  // null link in the shared trees
+
+enum SharedStateResult {
+    SS_SUCCESS,
+    SS_FAILURE,
+    SS_BUSY         // the owner kept publishing for as long as the reader waited
+};
+
+// A read-only image of the union-find and the rank trees, laid out in one shared-memory segment.
+// Every link is an index into the segment's node array instead of a pointer, so the image is valid
+// at whatever address a process maps it, and readers answer queries straight from the mapping.
+// The owner republishes with a sequence lock: readers retry if the sequence changed under them, backing off from
+// spinning to yielding to sleeping, and give up with SS_BUSY after about a second.
+// If a republish needs a bigger segment, the old one is marked retired and readers re-attach by name.
+// A publish copies every tree, so it costs O(servers) each time. Only the data centers' roots and trees are
+// published, not which data center a server is in, so readers can't look servers up.
+class SharedState {
+public:
+    struct Node {
+        int traffic;
+        ServerID serverID;
+        int left, right;            // indices in the node array
+        int subTreeSize, subTreeTraffic;
+    };
+
+    struct Header {
+        int magic;
+        int sequence;           // odd while a publish is in progress, 1 until the first one ends
+        int retired;            // a newer segment replaced this one
+        int dataCenterNum;
+        int nodeCount;
+        int globalTree;         // root node of the tree of all servers
+        long segmentSize;
+        // followed by: int roots[dataCenterNum], int trees[dataCenterNum], Node nodes[nodeCount]
+    };
+
+    ~SharedState();
+    SharedState(const SharedState& other) = delete;
+    SharedState& operator=(const SharedState& other) = delete;
+
+    // owner side
+    static SharedState* Create(const char* name);
+    SharedStateResult BeginPublish(int dataCenterNum, int nodeCount);
+    void SetRoot(int dataCenterIdx, int rootIdx);
+    int BuildTree(const ServerKey* sorted, int count);  // returns the root node of a balanced tree
+    void SetTree(int rootIdx, int node);
+    void SetGlobalTree(int node);
+    void EndPublish();
+
+    // reader side
+    static SharedState* Attach(const char* name);
+    SharedStateResult SumHighestTrafficServers(DataCenterID dataCenterID, int k, int* traffic);
+
+private:
+    char* name;
+    bool owner;
+    int fd;
+    char* segment;
+    long segmentSize;
+    int builtNodes;     // how many nodes the current publish built so far
+
+    SharedState(const char* name, bool owner);
+    SharedStateResult Map(long size, int sequence = 1);    // a new owner's segment starts at sequence, which is odd
+    void Unmap();
+    SharedStateResult Reattach();
+
+    Header* header() const { return (Header*)segment; }
+    int* roots() const { return (int*)(segment + sizeof(Header)); }
+    int* trees() const { return roots() + header()->dataCenterNum; }
+    Node* nodes() const { return (Node*)(trees() + header()->dataCenterNum); }
+    static long RequiredSize(int dataCenterNum, int nodeCount);
+
+    int BuildTreeHelp(const ServerKey* sorted, int first, int last);
+    static bool SumHighestHelp(const Node* nodeArray, int nodeCount, int tree, int k, int* traffic);
+};
+
+#endif //DATACENTERS_WET2_SHAREDSTATE_H
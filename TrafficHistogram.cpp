@@ -0,0 +1,95 @@
+#include <cstring>
+#include "TrafficHistogram.h"
+
+TrafficHistogram::TrafficHistogram() : buckets(nullptr), count(0) {}
+
+TrafficHistogram::TrafficHistogram(const TrafficHistogram& other) : buckets(nullptr), count(0) {
+    *this = other;
+}
+
+TrafficHistogram& TrafficHistogram::operator=(const TrafficHistogram& other) {
+    if (this == &other) return *this;
+    if (!other.buckets) {
+        Release();
+    } else {
+        if (!buckets) Allocate();   // before anything changes
+        memcpy(buckets, other.buckets, sizeof(Buckets));
+    }
+    count = other.count;
+    return *this;
+}
+
+TrafficHistogram::~TrafficHistogram() {
+    Release();
+}
+
+void TrafficHistogram::Add(int traffic) {
+    if (!buckets) Allocate();
+    int bucket = Bucket(traffic);
+    buckets->counts[bucket]++;
+    buckets->sums[bucket] += traffic;
+    buckets->groupCounts[bucket >> HISTOGRAM_PRECISION_BITS]++;
+    buckets->groupSums[bucket >> HISTOGRAM_PRECISION_BITS] += traffic;
+    count++;
+}
+
+void TrafficHistogram::Remove(int traffic) {
+    int bucket = Bucket(traffic);
+    buckets->counts[bucket]--;
+    buckets->sums[bucket] -= traffic;
+    buckets->groupCounts[bucket >> HISTOGRAM_PRECISION_BITS]--;
+    buckets->groupSums[bucket >> HISTOGRAM_PRECISION_BITS] -= traffic;
+    count--;
+}
+
+int TrafficHistogram::SumHighestTrafficServers(int k) const {
+    if (k <= 0 || count == 0) return 0;
+
+    // whole groups from the top, then whole buckets of the group k ends in
+    const int* counts = buckets->counts;
+    const long long* sums = buckets->sums;
+    const int* groupCounts = buckets->groupCounts;
+    const long long* groupSums = buckets->groupSums;
+    long long sum = 0;
+    int left = k;
+    for (int group = HISTOGRAM_GROUPS - 1; group >= 0 && left > 0; group--) {
+        if (groupCounts[group] <= left) {
+            sum += groupSums[group];
+            left -= groupCounts[group];
+            continue;
+        }
+
+        for (int bucket = (group + 1) * HISTOGRAM_SUB_BUCKETS - 1; left > 0; bucket--) {
+            if (counts[bucket] <= left) {
+                sum += sums[bucket];
+                left -= counts[bucket];
+                continue;
+            }
+
+            // left traffics of the bucket, at its average (split so that nothing overflows)
+            long long average = sums[bucket] / counts[bucket], remainder = sums[bucket] % counts[bucket];
+            sum += average * left + remainder * left / counts[bucket];
+            left = 0;
+        }
+    }
+    return (int)sum;
+}
+
+int TrafficHistogram::Bucket(int traffic) {
+    if (traffic < HISTOGRAM_SUB_BUCKETS) return traffic;
+
+    // the group of the highest bit, and the next HISTOGRAM_PRECISION_BITS bits inside it
+    int highestBit = 31 - __builtin_clz((unsigned int)traffic);
+    int group = highestBit - HISTOGRAM_PRECISION_BITS + 1;
+    int subBucket = (traffic >> (highestBit - HISTOGRAM_PRECISION_BITS)) - HISTOGRAM_SUB_BUCKETS;
+    return group * HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+void TrafficHistogram::Allocate() {
+    buckets = new Buckets();
+}
+
+void TrafficHistogram::Release() {
+    delete buckets;
+    buckets = nullptr;
+}
@@ -0,0 +1,43 @@
+#ifndef DATACENTERS_WET2_TRAFFICHISTOGRAM_H
+#define DATACENTERS_WET2_TRAFFICHISTOGRAM_H
+
+const int HISTOGRAM_PRECISION_BITS = 7;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_PRECISION_BITS;    // buckets in a group
+const int HISTOGRAM_GROUPS = 32 - HISTOGRAM_PRECISION_BITS;         // traffics are non-negative ints
+const int HISTOGRAM_BUCKETS = HISTOGRAM_GROUPS * HISTOGRAM_SUB_BUCKETS;
+
+// An approximate rank structure: no keys, only how many traffics (and their total) fall in every bucket.
+// Group 0 has a bucket for every traffic below HISTOGRAM_SUB_BUCKETS. Every other group is a power of two,
+// split into HISTOGRAM_SUB_BUCKETS equal buckets, so the traffics in a bucket are within 1/128 of each other.
+// A top-k sum takes whole buckets from the top and the average of the bucket it ends in: it is exact for
+// traffics below 128, and within 1% otherwise. An update is O(1), a query scans the groups and then one group.
+// The buckets are allocated with the first traffic, so a histogram that is never used (every ServersManager has one)
+// is only a pointer.
+class TrafficHistogram {
+public:
+    TrafficHistogram();
+    TrafficHistogram(const TrafficHistogram& other);
+    TrafficHistogram& operator=(const TrafficHistogram& other);
+    ~TrafficHistogram();
+
+    void Add(int traffic);
+    void Remove(int traffic);   // a traffic that was added
+    int Size() const { return count; }
+    int SumHighestTrafficServers(int k) const;
+
+private:
+    struct Buckets {
+        int counts[HISTOGRAM_BUCKETS];
+        long long sums[HISTOGRAM_BUCKETS];
+        int groupCounts[HISTOGRAM_GROUPS];
+        long long groupSums[HISTOGRAM_GROUPS];
+    };
+    Buckets* buckets;   // nullptr while empty
+    int count;
+
+    static int Bucket(int traffic);
+    void Allocate();
+    void Release();
+};
+
+#endif //DATACENTERS_WET2_TRAFFICHISTOGRAM_H
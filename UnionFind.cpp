@@ -5,9 +5,9 @@ Set UnionFind::Find(int idx) {
 
     // go to idx's root
     int root = idx;
-    while (sets[root].parent != IS_ROOT) root = sets[root].parent;
+    while (sets.Get(root).parent != IS_ROOT) root = sets.Get(root).parent;
 
-    // paths shrinking
+    // paths shrinking (cells that aren't roots were written, so this never allocates)
     int tmp;
     for (int i = idx; i != root; i = tmp){
         tmp = sets[i].parent;
@@ -22,15 +22,19 @@ Set UnionFind::Union(Set a, Set b) {
     if (a==b) return a;
 
     // put the bigger group's root in "a" for convenience
-    if (sets[a].size < sets[b].size) {
+    if (sets.Get(a).size < sets.Get(b).size) {
         int tmp = a;
         a = b;
         b = tmp;
     }
 
+    // get both cells before changing any, allocating them may fail
+    UnionFindCell& cellA = sets[a];
+    UnionFindCell& cellB = sets[b];
+
     // add b's size to a's size and make a as the root
-    sets[a].size += sets[b].size;
-    sets[b].parent = a;
+    cellA.size += cellB.size;
+    cellB.parent = a;
 
     return a;
 }
\ No newline at end of file
@@ -1,15 +1,20 @@
 #ifndef DATACENTERS_WET2_UNIONFIND_H
 #define DATACENTERS_WET2_UNIONFIND_H
 
+#include "ChunkedArray.h"
+
 const int IS_ROOT = -1;
 typedef int Set;
 
 class UnionFind {
 public:
-    explicit UnionFind(int size) : sets(new UnionFindCell[size]), elementsNum(size) {}
-    ~UnionFind() { delete[] sets; }
+    // the cells are allocated in chunks, when a set in them is first united
+    explicit UnionFind(int size) : sets(size), elementsNum(size) {}
     Set Find(int idx);
     Set Union(Set a, Set b);
+    void Grow(int newSize) { sets.Grow(newSize); elementsNum = newSize; }   // the new elements are single sets
+    int Size() const { return elementsNum; }
+    bool IsRoot(Set set) const { return sets.Get(set).parent == IS_ROOT; }    // by array index, doesn't compress
 
 private:
 
@@ -20,7 +25,7 @@ private:
         int size;
     };
 
-    UnionFindCell* sets;
+    ChunkedArray<UnionFindCell> sets;
     int elementsNum;
 };
 
@@ -0,0 +1,26 @@
+#include <cstring>
+#include "WriteBuffer.h"
+
+WriteBuffer::WriteBuffer(const WriteBuffer& other) : entries(nullptr), count(0), capacity(0) {
+    *this = other;
+}
+
+WriteBuffer& WriteBuffer::operator=(const WriteBuffer& other) {
+    if (this == &other) return *this;
+    if (capacity != other.capacity) SetCapacity(other.capacity);
+    if (other.count > 0) memcpy(entries, other.entries, other.count * sizeof(ServerKey));
+    count = other.count;
+    return *this;
+}
+
+WriteBuffer::~WriteBuffer() {
+    delete[] entries;
+}
+
+void WriteBuffer::SetCapacity(int newCapacity) {
+    auto newEntries = newCapacity > 0 ? new ServerKey[newCapacity] : nullptr;
+    delete[] entries;
+    entries = newEntries;
+    count = 0;
+    capacity = newCapacity;
+}
@@ -0,0 +1,31 @@
+#ifndef DATACENTERS_WET2_WRITEBUFFER_H
+#define DATACENTERS_WET2_WRITEBUFFER_H
+
+#include "Server.h"
+
+// Traffics that were set and not applied to the rank tree yet, one entry per server, in the order the servers were
+// first set. A server set again overwrites its entry (see ServersManager::BufferWrites).
+// The room for the entries is allocated once, when the capacity is set.
+class WriteBuffer {
+public:
+    WriteBuffer() : entries(nullptr), count(0), capacity(0) {}
+    WriteBuffer(const WriteBuffer& other);
+    WriteBuffer& operator=(const WriteBuffer& other);
+    ~WriteBuffer();
+
+    int Add(const ServerKey& entry) { entries[count] = entry; return count++; }    // its index. not full
+    void Set(int index, int traffic) { entries[index].traffic = traffic; }
+    void Drop(int index) { entries[index].serverId = 0; }     // its server was removed
+    const ServerKey* Entries() const { return entries; }     // a dropped entry has server ID 0
+    int Size() const { return count; }
+    int Capacity() const { return capacity; }
+    bool IsFull() const { return count == capacity; }
+    void Clear() { count = 0; }
+    void SetCapacity(int newCapacity);  // drops the entries, 0 frees the room
+
+private:
+    ServerKey* entries;
+    int count, capacity;
+};
+
+#endif //DATACENTERS_WET2_WRITEBUFFER_H
@@ -0,0 +1,97 @@
+/***************************************************************************/
+/*                                                                         */
+/* File Name : rank_tree_bench.cpp                                         */
+/*                                                                         */
+/* Times the AVL rank tree against the B+-tree on the same workload:       */
+/* random inserts, top-k sums, traffic updates (remove + insert), a merge  */
+/* of two trees of the same size, and removing everything.                 */
+/*                                                                         */
+/* usage: rank_tree_bench [servers] [queries]                              */
+/***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "../AVL.h"
+#include "../AggregatePolicies.h"
+#include "../BPlusTree.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef AugmentedAVL<ServerKey, TrafficSum> AVL;    // the ServersManager instantiation
+
+static int TopK(const AVL& tree, int k) { return tree.HighestAggregate(k); }
+static int TopK(const BPlusTree& tree, int k) { return tree.SumHighestTrafficServers(k); }
+
+static double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// the same keys for both trees: distinct IDs in random order, traffic in [1, 1000000]
+static void MakeKeys(ServerKey* keys, int n, int firstID, unsigned seed) {
+    srand(seed);
+    for (int i = 0; i < n; i++) keys[i] = ServerKey(1 + rand() % 1000000, firstID + i);
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        ServerKey temp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = temp;
+    }
+}
+
+template<class Tree>
+static void Run(const char* name, const ServerKey* keys, const ServerKey* otherKeys, int n, int queries) {
+    Tree tree, other;
+    long checksum = 0;
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; i++) tree.insert(keys[i]);
+    double insertTime = Seconds(start);
+
+    start = Clock::now();
+    for (int i = 0; i < queries; i++) checksum += TopK(tree, 1 + (int)((long)i * 7919 % n));
+    double queryTime = Seconds(start);
+
+    start = Clock::now();
+    for (int i = 0; i < queries; i++) {
+        // a traffic update is a remove and an insert of the same server
+        ServerKey key = keys[(long)i * 104729 % n];
+        tree.remove(key);
+        tree.insert(key);
+    }
+    double updateTime = Seconds(start);
+
+    for (int i = 0; i < n; i++) other.insert(otherKeys[i]);
+    start = Clock::now();
+    Tree merged = Tree::MergeRankTrees(tree, other);
+    double mergeTime = Seconds(start);
+    checksum += TopK(merged, n);
+
+    start = Clock::now();
+    for (int i = 0; i < n; i++) tree.remove(keys[i]);
+    double removeTime = Seconds(start);
+
+    printf("%-6s insert %8.3f  top-k %8.3f  update %8.3f  merge %8.3f  remove %8.3f  (checksum %ld)\n",
+           name, insertTime, queryTime, updateTime, mergeTime, removeTime, checksum);
+}
+
+int main(int argc, const char** argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int queries = (argc > 2) ? atoi(argv[2]) : 1000000;
+    if (n <= 0 || queries < 0) {
+        fprintf(stderr, "usage: %s [servers] [queries]\n", argv[0]);
+        return 1;
+    }
+
+    auto keys = new ServerKey[n];
+    auto otherKeys = new ServerKey[n];
+    MakeKeys(keys, n, 1, 1);
+    MakeKeys(otherKeys, n, n + 1, 2);
+
+    printf("%d servers, %d queries (seconds)\n", n, queries);
+    Run<AVL>("AVL", keys, otherKeys, n, queries);
+    Run<BPlusTree>("B+", keys, otherKeys, n, queries);
+
+    delete[] otherKeys;
+    delete[] keys;
+    return 0;
+}
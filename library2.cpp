@@ -12,6 +12,68 @@ void* Init(int n) {
     }
 }
 
+void* InitPartitioned(int n, int workersNum) {
+    if (workersNum <= 0) return nullptr;
+    try {
+        return (void*)DataCentersManager::CreatePartitioned(n, workersNum);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+void* InitBPlusTree(int n) {
+    try {
+        return (void*)new DataCentersManager(n, RANK_TREE_BPLUS);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+void* InitLazyMerge(int n) {
+    try {
+        return (void*)new DataCentersManager(n, RANK_TREE_AVL, true);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+void* InitApproximate(int n) {
+    try {
+        return (void*)new DataCentersManager(n, RANK_TREE_AVL, false, true);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+void* InitWindowed(int n, int windowEpochs) {
+    if (windowEpochs <= 0 || windowEpochs > WINDOW_MAX_EPOCHS) return nullptr;
+    try {
+        return (void*)new DataCentersManager(n, RANK_TREE_AVL, false, false, windowEpochs);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+StatusType AddDataCenter(void *DS, int *dataCenterID) {
+    if (!DS || !dataCenterID) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->AddDataCenter(dataCenterID));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType FreezeDataCenter(void *DS, int dataCenterID) {
+    if (!DS || dataCenterID < 0) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->FreezeDataCenter(dataCenterID));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
 StatusType MergeDataCenters(void *DS, int dataCenter1, int dataCenter2) {
     if (!DS || dataCenter1 <= 0 || dataCenter2 <= 0) return INVALID_INPUT;
     auto manager = (DataCentersManager*)DS;
@@ -62,8 +124,230 @@ StatusType SumHighestTrafficServers(void *DS, int dataCenterID,  int k, int *tra
     }
 }
 
+StatusType GetTrafficByRank(void *DS, int dataCenterID, int rank, int *traffic) {
+    if (!DS || dataCenterID < 0 || rank <= 0 || !traffic) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->TrafficByRank(dataCenterID, rank, traffic));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType GetRankOfTraffic(void *DS, int dataCenterID, int traffic, int *rank) {
+    if (!DS || dataCenterID < 0 || traffic < 0 || !rank) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->RankOfTraffic(dataCenterID, traffic, rank));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType CountTrafficAbove(void *DS, int dataCenterID, int traffic, int *count, int *trafficSum) {
+    if (!DS || dataCenterID < 0 || traffic < 0 || !count || !trafficSum) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->CountTrafficAbove(dataCenterID, traffic, count, trafficSum));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType CountTrafficBelow(void *DS, int dataCenterID, int traffic, int *count, int *trafficSum) {
+    if (!DS || dataCenterID < 0 || traffic < 0 || !count || !trafficSum) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->CountTrafficBelow(dataCenterID, traffic, count, trafficSum));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType GetTrafficPercentile(void *DS, int dataCenterID, int percentile, int *traffic) {
+    if (!DS || dataCenterID < 0 || percentile < 0 || percentile > 100 || !traffic) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->TrafficPercentile(dataCenterID, percentile, traffic));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType GetHighestTrafficServers(void *DS, int dataCenterID, int k, int *serverIDs, int *traffics, int *count) {
+    if (!DS || dataCenterID < 0 || k < 0 || !serverIDs || !traffics || !count) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->HighestTrafficServers(dataCenterID, k, serverIDs, traffics, count));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType GetServersInTrafficRange(void *DS, int dataCenterID, int low, int high, int maxCount,
+                                    int *serverIDs, int *traffics, int *count) {
+    if (!DS || dataCenterID < 0 || low < 0 || high < low || maxCount < 0 || !serverIDs || !traffics || !count) {
+        return INVALID_INPUT;
+    }
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->TrafficRangeServers(dataCenterID, low, high, maxCount, serverIDs, traffics, count));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType SumHighestTrafficServersBatch(void *DS, int queriesNum, const int *dataCenterIDs, const int *ks,
+                                         int *traffics) {
+    if (!DS || queriesNum < 0) return INVALID_INPUT;
+    if (queriesNum > 0 && (!dataCenterIDs || !ks || !traffics)) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->SumHighestTrafficServers(queriesNum, dataCenterIDs, ks, traffics));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType KeepTopPrefix(void *DS, int limit) {
+    if (!DS || limit < 0) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->KeepTopPrefix(limit));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType SubscribeTrafficAlert(void *DS, int dataCenterID, int k, int threshold, TrafficAlert alert, void *context,
+                                 int *subscriptionID) {
+    if (!DS || dataCenterID < 0 || k < 0 || !alert || !subscriptionID) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->Subscribe(dataCenterID, k, threshold, alert, context, subscriptionID));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType UnsubscribeTrafficAlert(void *DS, int subscriptionID) {
+    if (!DS || subscriptionID <= 0) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    return (StatusType)(manager->Unsubscribe(subscriptionID));
+}
+
+StatusType MoveServer(void *DS, int serverID, int dataCenterID) {
+    if (!DS || serverID <= 0 || dataCenterID <= 0) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->MoveServer(serverID, dataCenterID));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType MoveServers(void *DS, int count, const int *serverIDs, const int *dataCenterIDs) {
+    if (!DS || count < 0) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->MoveServers(count, serverIDs, dataCenterIDs));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType BufferWrites(void *DS, int capacity) {
+    if (!DS || capacity < 0) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->BufferWrites(capacity));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType AdvanceEpoch(void *DS) {
+    if (!DS) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->AdvanceEpoch());
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType GetFleetReport(void *DS, int k, int maxCount, int *dataCenterIDs, int *serversNums, int *trafficSums,
+                          int *highestSums, int *count) {
+    if (!DS || k < 0 || maxCount < 0 || !count) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->FleetReport(k, maxCount, dataCenterIDs, serversNums, trafficSums, highestSums, count));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
 void Quit(void** DS) {
     auto manager = (DataCentersManager*)(*DS);
     delete manager;
     *DS = nullptr;
 }
+
+
+void* InitWithJournal(int n, const char* snapshotPath, const char* journalPath) {
+    if (!snapshotPath || !journalPath) return nullptr;
+    try {
+        return (void*)DataCentersManager::Recover(n, snapshotPath, journalPath);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+StatusType Checkpoint(void *DS) {
+    if (!DS) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->Checkpoint());
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+StatusType CommitJournal(void *DS) {
+    if (!DS) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    return (StatusType)(manager->CommitJournal());
+}
+
+StatusType PublishSharedState(void *DS, const char* name) {
+    if (!DS || !name) return INVALID_INPUT;
+    auto manager = (DataCentersManager*)DS;
+    try {
+        return (StatusType)(manager->PublishSharedState(name));
+    } catch (std::bad_alloc& ba) {
+        return ALLOCATION_ERROR;
+    }
+}
+
+void* AttachSharedState(const char* name) {
+    if (!name) return nullptr;
+    try {
+        return (void*)SharedState::Attach(name);
+    } catch (std::bad_alloc& ba) {
+        return nullptr;
+    }
+}
+
+StatusType SharedSumHighestTrafficServers(void *shared, int dataCenterID, int k, int *traffic) {
+    if (!shared || dataCenterID < 0 || k < 0 || !traffic) return INVALID_INPUT;
+    auto state = (SharedState*)shared;
+    SharedStateResult result = state->SumHighestTrafficServers(dataCenterID, k, traffic);
+    if (result == SS_BUSY) return BUSY;
+    return (result == SS_SUCCESS) ? SUCCESS : FAILURE;
+}
+
+void DetachSharedState(void** shared) {
+    auto state = (SharedState*)(*shared);
+    delete state;
+    *shared = nullptr;
+}
@@ -24,7 +24,8 @@ typedef enum {
     SUCCESS = 0,
     FAILURE = -1,
     ALLOCATION_ERROR = -2,
-    INVALID_INPUT = -3
+    INVALID_INPUT = -3,
+    BUSY = -4       /* only from SharedSumHighestTrafficServers */
 } StatusType;
 
 
@@ -42,6 +43,175 @@ StatusType SumHighestTrafficServers(void *DS, int dataCenterID,  int k, int *tra
 
 void Quit(void** DS);
 
+/* Partitioned engine
+ * -----------------------------------
+ * Same as Init, but the data centers are partitioned across workersNum worker threads.
+ * The returned structure is used with the functions above. Mutations are not waited for: if a worker runs out
+ * of memory, the next call and every call after it return ALLOCATION_ERROR. */
+void* InitPartitioned(int n, int workersNum);
+
+/* Rank tree engine
+ * -----------------------------------
+ * Same as Init, but the servers of every data center are ordered by traffic in a B+-tree
+ * instead of an AVL tree. */
+void* InitBPlusTree(int n);
+
+/* Lazy merge
+ * -----------------------------------
+ * Same as Init, but MergeDataCenters only links the merged data centers, in O(1). Their servers stay
+ * where they are and queries on the merged data center search all of its parts at once; the parts are
+ * merged for real once there are more than a few of them. */
+void* InitLazyMerge(int n);
+
+/* Approximate global queries
+ * -----------------------------------
+ * Same as Init, but all the servers (dataCenterID 0) are counted in a histogram of traffic buckets instead of
+ * a rank tree: SumHighestTrafficServers(DS, 0, k, ...) is exact for traffics below 128 and within 1% otherwise,
+ * and the rank tree of all the servers isn't kept. The data centers' answers stay exact.
+ * The order statistics and the listings of dataCenterID 0, and PublishSharedState, return FAILURE. */
+void* InitApproximate(int n);
+
+/* Windowed traffic
+ * -----------------------------------
+ * Same as Init, but time is split into epochs and a server's traffic is its total over the last windowEpochs
+ * of them (1 <= windowEpochs <= 16): SetTraffic sets its traffic in the current epoch, and every query ranks
+ * the servers by their window totals. AdvanceEpoch starts the next epoch, the oldest one leaves the window.
+ * It only touches the servers that had traffic in that epoch. INVALID_INPUT if a total would exceed INT_MAX;
+ * AdvanceEpoch returns FAILURE on a structure that isn't windowed. */
+void* InitWindowed(int n, int windowEpochs);
+
+StatusType AdvanceEpoch(void *DS);
+
+/* Growing
+ * -----------------------------------
+ * AddDataCenter adds a data center to the structure and returns its ID in dataCenterID (the next one after
+ * the existing IDs). Existing data centers and their servers are not moved or copied. */
+StatusType AddDataCenter(void *DS, int *dataCenterID);
+
+/* Migration
+ * -----------------------------------
+ * MoveServer moves a server to another data center and keeps its traffic, instead of RemoveServer, AddServer
+ * and SetTraffic. The ranking of all the servers isn't touched. MoveServers moves serverIDs[i] to
+ * dataCenterIDs[i] for every i < count, in order; if any of them is invalid (INVALID_INPUT) or doesn't exist
+ * (FAILURE), none is moved. On ALLOCATION_ERROR the moves before the one that ran out of memory stay done
+ * (and journaled), the rest aren't. Not available with InitPartitioned (FAILURE). */
+StatusType MoveServer(void *DS, int serverID, int dataCenterID);
+StatusType MoveServers(void *DS, int count, const int *serverIDs, const int *dataCenterIDs);
+
+/* Freezing
+ * -----------------------------------
+ * FreezeDataCenter keeps the servers of the data center (all the servers if dataCenterID is 0) in a sorted
+ * array with prefix sums of their traffic, so SumHighestTrafficServers on it is a single lookup.
+ * The next change of its servers' traffic turns it back to normal. */
+StatusType FreezeDataCenter(void *DS, int dataCenterID);
+
+/* Order statistics
+ * -----------------------------------
+ * Over the servers of a data center, or over all the servers if dataCenterID is 0. Servers without traffic
+ * count as traffic 0. All of them are O(log n); they are not available with InitPartitioned (FAILURE).
+ * GetTrafficByRank: the traffic of the rank-th highest server (1 is the highest), FAILURE if there are less servers.
+ * GetRankOfTraffic: 1 + the number of servers with more traffic.
+ * CountTrafficAbove / CountTrafficBelow: the number of servers with more / less traffic, and their total traffic.
+ * GetTrafficPercentile: the lowest traffic that at least percentile% of the servers don't exceed (nearest rank),
+ * percentile is in [0, 100]. FAILURE if there are no servers. */
+StatusType GetTrafficByRank(void *DS, int dataCenterID, int rank, int *traffic);
+StatusType GetRankOfTraffic(void *DS, int dataCenterID, int traffic, int *rank);
+StatusType CountTrafficAbove(void *DS, int dataCenterID, int traffic, int *count, int *trafficSum);
+StatusType CountTrafficBelow(void *DS, int dataCenterID, int traffic, int *count, int *trafficSum);
+StatusType GetTrafficPercentile(void *DS, int dataCenterID, int percentile, int *traffic);
+
+/* Server listings
+ * -----------------------------------
+ * The servers with traffic, highest first (ties by the higher ID), written to serverIDs and traffics,
+ * which have room for k / maxCount entries. count is set to the number written. Servers without traffic
+ * aren't listed. dataCenterID 0 lists all the servers.
+ * GetHighestTrafficServers: the k servers with the highest traffic.
+ * GetServersInTrafficRange: the servers with low <= traffic <= high, at most maxCount of them. */
+StatusType GetHighestTrafficServers(void *DS, int dataCenterID, int k, int *serverIDs, int *traffics, int *count);
+StatusType GetServersInTrafficRange(void *DS, int dataCenterID, int low, int high, int maxCount,
+                                    int *serverIDs, int *traffics, int *count);
+
+/* Top-k answers
+ * -----------------------------------
+ * Repeated SumHighestTrafficServers queries are answered from a cache until the data center changes.
+ * KeepTopPrefix makes every data center (and all the servers) keep its limit highest traffics apart,
+ * updated with every change, so SumHighestTrafficServers with k <= limit takes O(1).
+ * Each data center then takes room for limit servers. 0 <= limit <= 256, 0 stops keeping them. */
+StatusType KeepTopPrefix(void *DS, int limit);
+
+/* Write buffering
+ * -----------------------------------
+ * BufferWrites makes SetTraffic only record the new traffic, for up to capacity servers per data center (and
+ * as many for all the servers). A server set again before it's applied only overwrites its recorded traffic.
+ * The recorded traffics of a data center are applied at once, sorted by traffic, before the next query on it
+ * (or when its buffer is full), so the answers are the same as without buffering. A traffic alert is evaluated
+ * after every change, so the writes it watches (of its data center, or of all the servers for dataCenterID 0)
+ * are applied one by one as without buffering.
+ * 0 <= capacity <= 65536, 0 applies everything and stops buffering. Not available with InitPartitioned (FAILURE). */
+StatusType BufferWrites(void *DS, int capacity);
+
+/* Traffic alerts
+ * -----------------------------------
+ * SubscribeTrafficAlert watches the sum of the k highest traffics of a data center (all the servers if
+ * dataCenterID is 0), and calls alert(context, subscriptionID, trafficSum, above) every time it crosses
+ * threshold: above is 1 when it became at least threshold, 0 when it dropped below it. It's evaluated after
+ * the changes of that data center only, and it follows the data center through its merges.
+ * The alert is called from inside the call that made the change, and must not call this library.
+ * UnsubscribeTrafficAlert stops it, FAILURE if it was stopped already. */
+typedef void (*TrafficAlert)(void *context, int subscriptionID, int trafficSum, int above);
+
+StatusType SubscribeTrafficAlert(void *DS, int dataCenterID, int k, int threshold, TrafficAlert alert, void *context,
+                                 int *subscriptionID);
+
+StatusType UnsubscribeTrafficAlert(void *DS, int subscriptionID);
+
+/* Fleet report
+ * -----------------------------------
+ * GetFleetReport reports on every data center (data centers that were merged are one, reported by one of their
+ * IDs): the number of its servers, their total traffic and the sum of its k highest traffics. The arrays have
+ * room for maxCount data centers. count is set to the number of data centers, FAILURE if it's more than maxCount.
+ * Large fleets are scanned by several threads. */
+StatusType GetFleetReport(void *DS, int k, int maxCount, int *dataCenterIDs, int *serversNums, int *trafficSums,
+                          int *highestSums, int *count);
+
+/* Batched queries
+ * -----------------------------------
+ * SumHighestTrafficServersBatch answers queriesNum SumHighestTrafficServers queries at once: traffics[i] is
+ * the sum for (dataCenterIDs[i], ks[i]). Queries on the same data center share one descent of its tree.
+ * INVALID_INPUT if any of the queries is invalid, then none is answered. */
+StatusType SumHighestTrafficServersBatch(void *DS, int queriesNum, const int *dataCenterIDs, const int *ks,
+                                         int *traffics);
+
+/* Durability
+ * -----------------------------------
+ * InitWithJournal loads the snapshot in snapshotPath (if any, its number of data centers overrides n),
+ * replays the journal in journalPath on top of it and keeps journaling every successful mutation.
+ * Journal records are committed to disk in groups; CommitJournal forces the current group out.
+ * If a group can't be made durable it's kept and retried, and every mutation returns FAILURE without
+ * changing anything until it's committed (or a Checkpoint succeeds).
+ * Checkpoint writes a new snapshot and restarts the journal. If the snapshot was written but the journal
+ * couldn't be restarted, every mutation returns FAILURE until a Checkpoint succeeds. */
+void* InitWithJournal(int n, const char* snapshotPath, const char* journalPath);
+
+StatusType Checkpoint(void *DS);
+
+StatusType CommitJournal(void *DS);
+
+/* Shared memory
+ * -----------------------------------
+ * PublishSharedState copies the current state into the shared-memory segment "name" (a POSIX shm name,
+ * e.g. "/datacenters"). Other processes attach to it read-only and query it without going through the owner.
+ * A reader always sees the state of the last completed publish; before the first one, its queries fail.
+ * A query that keeps racing publishes waits for them, and returns BUSY if they didn't stop for about a second.
+ * Every publish copies all the trees. Only top-k sums are published, not which data center a server is in. */
+StatusType PublishSharedState(void *DS, const char* name);
+
+void* AttachSharedState(const char* name);
+
+StatusType SharedSumHighestTrafficServers(void *shared, int dataCenterID, int k, int *traffic);
+
+void DetachSharedState(void** shared);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,42 @@
+/****************************************************************************/
+/*                                                                          */
+/* File Name : Protocol.h                                                   */
+/*                                                                          */
+/* Binary protocol of the data centers server (server2.cpp).                */
+/* Every request and response has a fixed size and is sent in the host's   */
+/* byte order (the socket is a local Unix-domain socket).                   */
+/* A client may send any number of requests without waiting (pipelining);   */
+/* the responses come back in the same order the requests were sent.        */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef DATACENTERS_WET2_PROTOCOL_H
+#define DATACENTERS_WET2_PROTOCOL_H
+
+typedef enum {
+    OP_MERGE_DATA_CENTERS = 1,      /* arg1 = dataCenter1, arg2 = dataCenter2 */
+    OP_ADD_SERVER = 2,              /* arg1 = dataCenterID, arg2 = serverID */
+    OP_REMOVE_SERVER = 3,           /* arg1 = serverID */
+    OP_SET_TRAFFIC = 4,             /* arg1 = serverID, arg2 = traffic */
+    OP_SUM_HIGHEST_TRAFFIC = 5,     /* arg1 = dataCenterID, arg2 = k. the sum is returned in value */
+    OP_CHECKPOINT = 6               /* only if the server runs with a journal */
+} RequestOp;
+
+typedef struct {
+    int op;
+    int arg1, arg2;
+    int tag;        /* echoed back as is, clients may use it to match responses */
+} Request;
+
+/* the status of a mutation that was applied, but whose journal commit failed. it is not rolled back: later
+ * requests see it, and it becomes durable with the first commit that succeeds (the server keeps retrying,
+ * and refuses other mutations with FAILURE until then) */
+#define STATUS_NOT_DURABLE (100)
+
+typedef struct {
+    int status;     /* a StatusType, or STATUS_NOT_DURABLE */
+    int value;
+    int tag;
+} Response;
+
+#endif /* DATACENTERS_WET2_PROTOCOL_H */
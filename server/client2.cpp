@@ -0,0 +1,177 @@
+/***************************************************************************/
+/*                                                                         */
+/* File Name : client2.cpp                                                 */
+/*                                                                         */
+/* Reads the same commands as main2.cpp from stdin, sends them to a        */
+/* running server2 and prints the same output main2 would.                 */
+/* Requests are pipelined: up to PIPELINE_WINDOW requests are sent before  */
+/* their responses are read.                                               */
+/*                                                                         */
+/* usage: client2 <socket path> < commands                                 */
+/***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../library2.h"
+#include "Protocol.h"
+
+#define MAX_STRING_INPUT_SIZE (255)
+#define PIPELINE_WINDOW       (4096)
+
+#define StrCmp(Src1,Src2) ( strncmp((Src1),(Src2),strlen(Src1)) == 0 )
+
+static const char* ReturnValToStr(int val) {
+    switch (val) {
+        case SUCCESS:
+            return "SUCCESS";
+        case ALLOCATION_ERROR:
+            return "ALLOCATION_ERROR";
+        case FAILURE:
+            return "FAILURE";
+        case INVALID_INPUT:
+            return "INVALID_INPUT";
+        case STATUS_NOT_DURABLE:
+            return "NOT_DURABLE";
+        default:
+            return "";
+    }
+}
+
+static const char* OpToStr(int op) {
+    switch (op) {
+        case OP_MERGE_DATA_CENTERS:
+            return "MergeDataCenters";
+        case OP_ADD_SERVER:
+            return "AddServer";
+        case OP_REMOVE_SERVER:
+            return "RemoveServer";
+        case OP_SET_TRAFFIC:
+            return "SetTraffic";
+        case OP_SUM_HIGHEST_TRAFFIC:
+            return "SumHighestTrafficServers";
+        case OP_CHECKPOINT:
+            return "Checkpoint";
+        default:
+            return "";
+    }
+}
+
+static int sock = -1;
+static Request window[PIPELINE_WINDOW];
+static Response responses[PIPELINE_WINDOW];
+static int windowSize = 0;
+
+static bool SendAll(const void* data, long bytes) {
+    const char* ptr = (const char*)data;
+    while (bytes > 0) {
+        long written = write(sock, ptr, bytes);
+        if (written <= 0) return false;
+        ptr += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+static bool ReceiveAll(void* data, long bytes) {
+    char* ptr = (char*)data;
+    while (bytes > 0) {
+        long got = read(sock, ptr, bytes);
+        if (got <= 0) return false;
+        ptr += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+/* send the pending requests in one go, then print their responses in order */
+static bool Flush() {
+    if (windowSize == 0) return true;
+    if (!SendAll(window, windowSize * (long)sizeof(Request))) return false;
+    if (!ReceiveAll(responses, windowSize * (long)sizeof(Response))) return false;
+
+    for (int i = 0; i < windowSize; i++) {
+        if (window[i].op == OP_SUM_HIGHEST_TRAFFIC && responses[i].status == SUCCESS) {
+            printf("%s: %d\n", OpToStr(window[i].op), responses[i].value);
+        } else {
+            printf("%s: %s\n", OpToStr(window[i].op), ReturnValToStr(responses[i].status));
+        }
+    }
+    windowSize = 0;
+    return true;
+}
+
+static bool Queue(int op, int arg1, int arg2) {
+    Request& request = window[windowSize];
+    request.op = op;
+    request.arg1 = arg1;
+    request.arg2 = arg2;
+    request.tag = windowSize;
+
+    if (++windowSize == PIPELINE_WINDOW) return Flush();
+    return true;
+}
+
+/* translate one command line. returns false on a parse or connection error */
+static bool Parse(const char* command) {
+    int a = 0, b = 0;
+    if (command[0] == '\n' || command[0] == '\0') return false;
+    if (StrCmp("#", command)) {
+        if (!Flush()) return false;
+        if (strlen(command) > 1) printf("%s", command);
+        return true;
+    }
+    if (StrCmp("Init", command)) {  // the server is initialized already
+        if (!Flush()) return false;
+        printf("init done.\n");
+        return true;
+    }
+    if (StrCmp("Quit", command)) {
+        if (!Flush()) return false;
+        printf("quit done.\n");
+        return true;
+    }
+    if (StrCmp("MergeDataCenters", command) && sscanf(command + 17, "%d %d", &a, &b) == 2)
+        return Queue(OP_MERGE_DATA_CENTERS, a, b);
+    if (StrCmp("AddServer", command) && sscanf(command + 10, "%d %d", &a, &b) == 2)
+        return Queue(OP_ADD_SERVER, a, b);
+    if (StrCmp("RemoveServer", command) && sscanf(command + 13, "%d", &a) == 1)
+        return Queue(OP_REMOVE_SERVER, a, 0);
+    if (StrCmp("SetTraffic", command) && sscanf(command + 11, "%d %d", &a, &b) == 2)
+        return Queue(OP_SET_TRAFFIC, a, b);
+    if (StrCmp("SumHighestTrafficServers", command) && sscanf(command + 25, "%d %d", &a, &b) == 2)
+        return Queue(OP_SUM_HIGHEST_TRAFFIC, a, b);
+    if (StrCmp("Checkpoint", command))
+        return Queue(OP_CHECKPOINT, 0, 0);
+    return false;
+}
+
+int main(int argc, const char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <socket path>\n", argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1 || connect(sock, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        perror("connect");
+        return 1;
+    }
+
+    char buffer[MAX_STRING_INPUT_SIZE];
+    while (fgets(buffer, MAX_STRING_INPUT_SIZE, stdin) != NULL) {
+        if (!Parse(buffer)) break;
+    }
+    Flush();
+
+    close(sock);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#!/bin/sh
+###########################################################################
+#
+# File Name : compare_test.sh
+#
+# Runs the same random commands through main2 and through server2 with
+# client2, once in memory and once with a journal, and checks that the
+# outputs are the same.
+#
+# usage: server/compare_test.sh [commands] [data centers] [seed]
+###########################################################################
+
+set -e
+
+COMMANDS=${1:-100000}
+N=${2:-64}
+SEED=${3:-1}
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+SERVER_PID=
+trap 'if [ -n "$SERVER_PID" ]; then kill $SERVER_PID 2>/dev/null; fi; rm -rf "$WORK"' EXIT
+
+CXX=${CXX:-g++}
+LIBRARY=$(ls "$ROOT"/*.cpp | grep -v main2.cpp)
+$CXX -std=c++11 -O2 -o "$WORK/main2" "$ROOT/main2.cpp" $LIBRARY -lpthread -lrt
+$CXX -std=c++11 -O2 -o "$WORK/server2" "$ROOT/server/server2.cpp" $LIBRARY -lpthread -lrt
+$CXX -std=c++11 -O2 -o "$WORK/client2" "$ROOT/server/client2.cpp"
+
+# IDs and data centers go a little out of range, so the errors are compared too
+awk -v commands="$COMMANDS" -v n="$N" -v seed="$SEED" 'BEGIN {
+    srand(seed);
+    servers = 4 * n;
+    print "Init " n;
+    for (i = 0; i < commands; i++) {
+        op = int(rand() * 100);
+        id = int(rand() * (servers + 2));
+        dc = int(rand() * (n + 2));
+        if (op < 30)      print "AddServer " dc " " id;
+        else if (op < 45) print "RemoveServer " id;
+        else if (op < 75) print "SetTraffic " id " " (int(rand() * 1000) - 1);
+        else if (op < 80) print "MergeDataCenters " dc " " int(rand() * (n + 2));
+        else              print "SumHighestTrafficServers " dc " " (int(rand() * 20) - 1);
+    }
+    print "Quit";
+}' > "$WORK/commands"
+
+"$WORK/main2" < "$WORK/commands" > "$WORK/expected"
+
+# runs server2 with the given extra arguments and sends it the commands
+serve() {
+    rm -f "$WORK/socket"
+    "$WORK/server2" "$WORK/socket" "$N" "$@" &
+    SERVER_PID=$!
+    while [ ! -S "$WORK/socket" ]; do sleep 0.1; done
+    "$WORK/client2" "$WORK/socket" < "$WORK/commands" > "$WORK/actual"
+    kill $SERVER_PID
+    wait $SERVER_PID || true
+    SERVER_PID=
+    if ! cmp -s "$WORK/expected" "$WORK/actual"; then
+        echo "FAIL: server2 $* differs from main2"
+        diff "$WORK/expected" "$WORK/actual" | head -20
+        exit 1
+    fi
+}
+
+serve
+serve "$WORK/snapshot" "$WORK/journal"
+echo "PASS: $COMMANDS commands"
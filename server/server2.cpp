@@ -0,0 +1,337 @@
+/***************************************************************************/
+/*                                                                         */
+/* File Name : server2.cpp                                                 */
+/*                                                                         */
+/* Owns one data centers structure and serves the library2.h operations    */
+/* over a Unix-domain socket (see Protocol.h).                             */
+/*                                                                         */
+/* usage: server2 <socket path> <n> [<snapshot path> <journal path>]       */
+/*                                                                         */
+/* Every round of the event loop reads whatever all the clients sent,      */
+/* applies all the complete requests as one batch, commits the journal     */
+/* once for the whole batch (if there is one) and only then answers.       */
+/* If that commit fails, the batch's mutations are answered NOT_DURABLE     */
+/* (see Protocol.h) and the commit is retried every round until it works.  */
+/* A client's buffers are capped: it isn't read from while they're full.   */
+/***************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../library2.h"
+#include "Protocol.h"
+
+#define MAX_CLIENTS       (1024)
+#define READ_CHUNK_SIZE   (64 * 1024)
+#define POLL_TIMEOUT_MS   (1000)
+#define IN_BUFFER_MAX     (1024 * 1024)     /* unapplied requests of a client, past it it isn't read */
+#define OUT_BUFFER_MAX    (1024 * 1024)     /* unsent responses of a client, past it its requests wait */
+
+typedef struct {
+    char* data;
+    long begin, end, capacity;  /* the unconsumed bytes are data[begin..end) */
+} Buffer;
+
+typedef struct {
+    int fd;
+    bool closing;
+    Buffer in, out;
+    Buffer acked;   /* the offsets (from out.begin) of this round's responses to successful mutations */
+    bool stalled;   /* there was no memory for its responses, its requests wait for the next round */
+} Client;
+
+static volatile sig_atomic_t running = 1;
+
+static void OnSignal(int signal) {
+    (void)signal;
+    running = 0;
+}
+
+/***************************************************************************/
+/* Buffers                                                                 */
+/***************************************************************************/
+
+/* make room for "bytes" more bytes at the end of the buffer. false if there is no memory for it */
+static bool BufferReserve(Buffer* buffer, long bytes) {
+    // first move the unconsumed bytes to the beginning
+    if (buffer->begin > 0) {
+        memmove(buffer->data, buffer->data + buffer->begin, buffer->end - buffer->begin);
+        buffer->end -= buffer->begin;
+        buffer->begin = 0;
+    }
+
+    if (buffer->end + bytes <= buffer->capacity) return true;
+
+    long capacity = (buffer->capacity == 0) ? READ_CHUNK_SIZE : buffer->capacity;
+    while (capacity < buffer->end + bytes) capacity *= 2;
+
+    char* data = (char*)realloc(buffer->data, capacity);
+    if (!data) return false;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static bool BufferAppend(Buffer* buffer, const void* data, long bytes) {
+    if (!BufferReserve(buffer, bytes)) return false;
+    memcpy(buffer->data + buffer->end, data, bytes);
+    buffer->end += bytes;
+    return true;
+}
+
+static long BufferSize(const Buffer* buffer) {
+    return buffer->end - buffer->begin;
+}
+
+/***************************************************************************/
+/* Clients                                                                 */
+/***************************************************************************/
+
+/* read what the client sent so far, until its input buffer is full. returns false if the client is gone */
+static bool ReadClient(Client* client) {
+    while (BufferSize(&client->in) < IN_BUFFER_MAX) {
+        if (!BufferReserve(&client->in, READ_CHUNK_SIZE)) return false;    /* no memory for it, it's dropped */
+        long got = read(client->fd, client->in.data + client->in.end, READ_CHUNK_SIZE);
+        if (got > 0) {
+            client->in.end += got;
+            continue;
+        }
+        if (got == 0) return false;     /* EOF */
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    }
+    return true;
+}
+
+/* write as much of the pending responses as the socket takes. returns false if the client is gone */
+static bool WriteClient(Client* client) {
+    while (BufferSize(&client->out) > 0) {
+        long written = write(client->fd, client->out.data + client->out.begin, BufferSize(&client->out));
+        if (written > 0) {
+            client->out.begin += written;
+            continue;
+        }
+        return (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+    }
+    client->out.begin = client->out.end = 0;
+    return true;
+}
+
+static void CloseClient(Client* client) {
+    close(client->fd);
+    free(client->in.data);
+    free(client->out.data);
+    free(client->acked.data);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+/***************************************************************************/
+/* Requests                                                                */
+/***************************************************************************/
+
+/* apply one request. sets *mutated if the structure changed */
+static Response Apply(void* DS, const Request* request, bool* mutated) {
+    Response response;
+    response.status = INVALID_INPUT;
+    response.value = 0;
+    response.tag = request->tag;
+
+    switch (request->op) {
+        case OP_MERGE_DATA_CENTERS:
+            response.status = MergeDataCenters(DS, request->arg1, request->arg2);
+            break;
+        case OP_ADD_SERVER:
+            response.status = AddServer(DS, request->arg1, request->arg2);
+            break;
+        case OP_REMOVE_SERVER:
+            response.status = RemoveServer(DS, request->arg1);
+            break;
+        case OP_SET_TRAFFIC:
+            response.status = SetTraffic(DS, request->arg1, request->arg2);
+            break;
+        case OP_SUM_HIGHEST_TRAFFIC:
+            response.status = SumHighestTrafficServers(DS, request->arg1, request->arg2, &response.value);
+            return response;
+        case OP_CHECKPOINT:
+            response.status = Checkpoint(DS);
+            return response;
+        default:
+            return response;
+    }
+
+    if (response.status == SUCCESS) *mutated = true;
+    return response;
+}
+
+/* whether the client sent a complete request that wasn't applied, and there is room for its response */
+static bool HasRequest(const Client* client) {
+    return BufferSize(&client->in) >= (long)sizeof(Request) && BufferSize(&client->out) < OUT_BUFFER_MAX;
+}
+
+/* apply the complete requests the client sent, while there is room for their responses.
+ * sets *mutated if anything changed. returns false if there is no memory for the next response,
+ * the requests from it on are left for the next round */
+static bool ApplyClientRequests(void* DS, Client* client, bool* mutated) {
+    while (HasRequest(client)) {
+        /* the room for the response first, so every applied request is answered */
+        if (!BufferReserve(&client->out, sizeof(Response)) || !BufferReserve(&client->acked, sizeof(long))) return false;
+
+        Request request;
+        memcpy(&request, client->in.data + client->in.begin, sizeof(Request));
+        client->in.begin += sizeof(Request);
+
+        bool changed = false;
+        Response response = Apply(DS, &request, &changed);
+        if (changed) {
+            long offset = BufferSize(&client->out);
+            BufferAppend(&client->acked, &offset, sizeof(offset));
+            *mutated = true;
+        }
+        BufferAppend(&client->out, &response, sizeof(Response));
+    }
+    return true;
+}
+
+/* the journal commit of this round failed: its mutations are applied, but aren't durable yet */
+static void MarkNotDurable(Client* client) {
+    int status = STATUS_NOT_DURABLE;
+    for (long i = 0; i < BufferSize(&client->acked); i += sizeof(long)) {
+        long offset;
+        memcpy(&offset, client->acked.data + i, sizeof(offset));
+        memcpy(client->out.data + client->out.begin + offset + offsetof(Response, status), &status, sizeof(status));
+    }
+}
+
+/***************************************************************************/
+/* main                                                                    */
+/***************************************************************************/
+
+static int Listen(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, const char** argv) {
+    if (argc != 3 && argc != 5) {
+        fprintf(stderr, "usage: %s <socket path> <n> [<snapshot path> <journal path>]\n", argv[0]);
+        return 1;
+    }
+
+    const char* socketPath = argv[1];
+    int n = atoi(argv[2]);
+    bool journaled = (argc == 5);
+    void* DS = journaled ? InitWithJournal(n, argv[3], argv[4]) : Init(n);
+    if (DS == NULL) {
+        fprintf(stderr, "init failed.\n");
+        return 1;
+    }
+
+    int listenFd = Listen(socketPath);
+    if (listenFd == -1) {
+        perror("listen");
+        Quit(&DS);
+        return 1;
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    static Client clients[MAX_CLIENTS];
+    static struct pollfd fds[MAX_CLIENTS + 1];
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+    bool uncommitted = false;   // the last journal commit failed
+
+    while (running) {
+        // wait for new clients, requests, or room to write responses. a client with full buffers isn't read,
+        // and if requests that were read are waiting for room, there is no waiting
+        int fdsNum = 0;
+        bool waiting = false;
+        fds[fdsNum].fd = listenFd;
+        fds[fdsNum++].events = POLLIN;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd == -1) continue;
+            bool full = BufferSize(&clients[i].in) >= IN_BUFFER_MAX || BufferSize(&clients[i].out) >= OUT_BUFFER_MAX;
+            fds[fdsNum].fd = clients[i].fd;
+            fds[fdsNum++].events = (clients[i].closing || full ? 0 : POLLIN) | (BufferSize(&clients[i].out) > 0 ? POLLOUT : 0);
+            if (HasRequest(&clients[i]) && !clients[i].stalled) waiting = true;
+        }
+        if (poll(fds, fdsNum, waiting ? 0 : POLL_TIMEOUT_MS) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        // accept new clients
+        int fd;
+        while ((fd = accept(listenFd, NULL, NULL)) != -1) {
+            int slot = 0;
+            while (slot < MAX_CLIENTS && clients[slot].fd != -1) slot++;
+            if (slot == MAX_CLIENTS) {
+                close(fd);  // too many clients
+                continue;
+            }
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            clients[slot].fd = fd;
+        }
+
+        // read from every client, and apply everything that arrived as one batch
+        bool mutated = false;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd == -1) continue;
+            clients[i].acked.begin = clients[i].acked.end = 0;
+            if (!clients[i].closing && !ReadClient(&clients[i])) clients[i].closing = true;   // still answer what it sent
+            clients[i].stalled = !ApplyClientRequests(DS, &clients[i], &mutated);
+        }
+
+        // one journal commit for the whole batch, before anyone is told it succeeded.
+        // a group that failed is retried every round, and until then the library refuses mutations
+        if (journaled && (mutated || uncommitted)) {
+            uncommitted = (CommitJournal(DS) != SUCCESS);
+            if (uncommitted && mutated) {
+                fprintf(stderr, "journal commit failed, the batch's mutations are answered NOT_DURABLE.\n");
+                for (int i = 0; i < MAX_CLIENTS; i++) {
+                    if (clients[i].fd != -1) MarkNotDurable(&clients[i]);
+                }
+            }
+        }
+
+        // answer
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd == -1) continue;
+            bool alive = WriteClient(&clients[i]);
+            bool done = clients[i].closing && BufferSize(&clients[i].out) == 0 && !HasRequest(&clients[i]);
+            if (!alive || done) CloseClient(&clients[i]);
+        }
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd != -1) CloseClient(&clients[i]);
+    }
+    close(listenFd);
+    unlink(socketPath);
+    Quit(&DS);
+
+    return 0;
+}